@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <string.h>
+#include <coap.h>
+
+#include "xtimer.h"
+
+#include "block.h"
+#include "coap_msg.h"
+#include "microcoap_conn.h"
+
+#define BLOCK_SZX_MAX           (6)     /* 7 is reserved */
+
+#define COAP_RSPCODE_SERVICE_UNAVAILABLE    MAKE_RSPCODE(5, 3)
+
+/* Block1 reassembly, a single transfer at a time */
+static struct {
+    uint8_t addr[16];               /* client of the transfer */
+    size_t addr_len;
+    uint16_t port;
+    uint8_t token[8];
+    uint8_t tkl;
+    uint8_t active;                 /* a transfer was started */
+    uint8_t done;                   /* its last block was received */
+    uint32_t last_time;             /* of the last block, in xtimer us */
+    uint16_t last_id;               /* message ID of the last block */
+    block_opt_t last;               /* last block received */
+    size_t len;
+    uint8_t buf[BLOCK1_BUF_SIZE];
+} block1;
+static int block1_complete = 0;
+
+/* option values referenced by the response until it is built */
+static uint8_t block1_opt[BLOCK_OPT_MAX_LEN];
+static uint8_t block2_opt[BLOCK_OPT_MAX_LEN];
+
+int block_get(const coap_packet_t *pkt, uint8_t num, block_opt_t *block)
+{
+    uint8_t count;
+    const coap_option_t *opt = coap_findOptions(pkt, num, &count);
+
+    if ((opt == NULL) || (opt->buf.len > BLOCK_OPT_MAX_LEN)) {
+        return -1;
+    }
+    uint32_t value = coap_msg_get_uint(opt);
+
+    block->num = value >> 4;
+    block->more = (value >> 3) & 1;
+    block->szx = value & 0x7;
+    if (block->szx > BLOCK_SZX_MAX) {
+        block->szx = BLOCK_SZX_MAX;
+    }
+    return 0;
+}
+
+size_t block_put(uint8_t *buf, const block_opt_t *block)
+{
+    uint32_t value = (block->num << 4) | (block->more << 3) | block->szx;
+    unsigned len = coap_msg_uint_len(value);
+
+    coap_msg_put_uint(buf, value, len);
+    return len;
+}
+
+static void _add_block(coap_packet_t *pkt, uint8_t num,
+                       const block_opt_t *block, uint8_t *buf)
+{
+    coap_msg_add_option(pkt, num, buf, block_put(buf, block));
+}
+
+/* answer @p req with @p code instead of handling it */
+static int _reply(coap_rw_buffer_t *scratch, const coap_packet_t *req,
+                  coap_packet_t *rsp, coap_responsecode_t code)
+{
+    coap_msg_reply(scratch, req, rsp, code);
+    return 1;
+}
+
+/* whether @p req comes from the client of the current transfer */
+static int _block1_owner(const coap_packet_t *req, const uint8_t *addr,
+                         size_t addr_len, uint16_t port)
+{
+    return (addr_len == block1.addr_len) && (port == block1.port) &&
+           (memcmp(addr, block1.addr, addr_len) == 0) &&
+           (req->tok.len == block1.tkl) &&
+           (memcmp(req->tok.p, block1.token, block1.tkl) == 0);
+}
+
+/* hand the reassembled payload to the handler of @p req */
+static int _block1_deliver(coap_packet_t *req)
+{
+    req->payload.p = block1.buf;
+    req->payload.len = block1.len;
+    block1_complete = 1;
+    return 0;
+}
+
+int block1_receive(coap_rw_buffer_t *scratch, coap_packet_t *req,
+                   coap_packet_t *rsp)
+{
+    block_opt_t block;
+    uint8_t addr[16];
+    size_t addr_len;
+    uint16_t port;
+
+    block1_complete = 0;
+    if (block_get(req, COAP_OPTION_BLOCK1, &block) < 0) {
+        return 0;
+    }
+
+    size_t size = BLOCK_SIZE(block.szx);
+    size_t offset = block.num * size;
+    if (block.more && (req->payload.len != size)) {
+        /* only the last block may be shorter */
+        return _reply(scratch, req, rsp, COAP_RSPCODE_BAD_REQUEST);
+    }
+
+    microcoap_remote(addr, &addr_len, &port);
+    uint32_t now = xtimer_now_usec();
+    uint16_t id = (req->hdr.id[0] << 8) | req->hdr.id[1];
+    int owner = block1.active && _block1_owner(req, addr, addr_len, port);
+
+    /* the last block resent, its answer was lost */
+    if (owner && (id == block1.last_id)) {
+        block1.last_time = now;
+        if (!block.more) {
+            return _block1_deliver(req);
+        }
+        _reply(scratch, req, rsp, COAP_RSPCODE_CONTINUE);
+        _add_block(rsp, COAP_OPTION_BLOCK1, &block1.last, block1_opt);
+        return 1;
+    }
+
+    if (!owner && block1.active && !block1.done &&
+        ((now - block1.last_time) < BLOCK1_TIMEOUT)) {
+        /* another client is uploading */
+        return _reply(scratch, req, rsp, COAP_RSPCODE_SERVICE_UNAVAILABLE);
+    }
+    if (block.num == 0) {
+        if (req->tok.len > sizeof(block1.token)) {
+            return _reply(scratch, req, rsp, COAP_RSPCODE_BAD_REQUEST);
+        }
+        memcpy(block1.addr, addr, addr_len);
+        block1.addr_len = addr_len;
+        block1.port = port;
+        memcpy(block1.token, req->tok.p, req->tok.len);
+        block1.tkl = req->tok.len;
+        block1.active = 1;
+        block1.done = 0;
+        block1.len = 0;
+        owner = 1;
+    }
+    if (!owner || block1.done || (offset != block1.len)) {
+        return _reply(scratch, req, rsp,
+                      COAP_RSPCODE_REQUEST_ENTITY_INCOMPLETE);
+    }
+    if (offset + req->payload.len > sizeof(block1.buf)) {
+        block1.active = 0;
+        return _reply(scratch, req, rsp, COAP_RSPCODE_REQUEST_ENTITY_TOO_LARGE);
+    }
+
+    memcpy(&block1.buf[offset], req->payload.p, req->payload.len);
+    block1.len += req->payload.len;
+    block1.last = block;
+    block1.last_id = id;
+    block1.last_time = now;
+
+    if (block.more) {
+        _reply(scratch, req, rsp, COAP_RSPCODE_CONTINUE);
+        _add_block(rsp, COAP_OPTION_BLOCK1, &block, block1_opt);
+        return 1;
+    }
+
+    /* last block: hand the whole payload to the handler, kept for a
+       repeat of this block */
+    block1.done = 1;
+    return _block1_deliver(req);
+}
+
+void block_apply(const coap_packet_t *req, coap_packet_t *rsp)
+{
+    block_opt_t block = { 0, 0, BLOCK_SZX };
+    int asked = (block_get(req, COAP_OPTION_BLOCK2, &block) == 0);
+
+    /* acknowledge the last block of a reassembled request */
+    if (block1_complete) {
+        _add_block(rsp, COAP_OPTION_BLOCK1, &block1.last, block1_opt);
+        block1_complete = 0;
+    }
+
+    /* serve smaller blocks than asked for, keeping the same offset */
+    if (asked && (block.szx > BLOCK_SZX)) {
+        block.num <<= block.szx - BLOCK_SZX;
+        block.szx = BLOCK_SZX;
+    }
+
+    size_t size = BLOCK_SIZE(block.szx);
+    if (!asked && (rsp->payload.len <= size)) {
+        return;
+    }
+
+    size_t offset = block.num * size;
+    if ((offset > 0) && (offset >= rsp->payload.len)) {
+        rsp->hdr.code = COAP_RSPCODE_BAD_OPTION;
+        rsp->numopts = 0;
+        rsp->payload.len = 0;
+        return;
+    }
+
+    block.more = (offset + size < rsp->payload.len);
+    rsp->payload.p += offset;
+    rsp->payload.len -= offset;
+    if (rsp->payload.len > size) {
+        rsp->payload.len = size;
+    }
+    _add_block(rsp, COAP_OPTION_BLOCK2, &block, block2_opt);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <string.h>
+
+#include "cbor.h"
+
+#define CBOR_UINT       (0x00)
+#define CBOR_NEGINT     (0x20)
+#define CBOR_TEXT       (0x60)
+#define CBOR_ARRAY      (0x80)
+#define CBOR_MAP        (0xa0)
+#define CBOR_TAG        (0xc0)
+
+static void _put_byte(cbor_writer_t *writer, uint8_t byte)
+{
+    if (writer->pos < writer->len) {
+        writer->buf[writer->pos] = byte;
+    }
+    writer->pos++;
+}
+
+/* write an initial byte and its argument in the shortest form */
+static void _put_head(cbor_writer_t *writer, uint8_t major, uint32_t value)
+{
+    if (value < 24) {
+        _put_byte(writer, major | value);
+    }
+    else if (value <= 0xff) {
+        _put_byte(writer, major | 24);
+        _put_byte(writer, value);
+    }
+    else if (value <= 0xffff) {
+        _put_byte(writer, major | 25);
+        _put_byte(writer, value >> 8);
+        _put_byte(writer, value);
+    }
+    else {
+        _put_byte(writer, major | 26);
+        _put_byte(writer, value >> 24);
+        _put_byte(writer, value >> 16);
+        _put_byte(writer, value >> 8);
+        _put_byte(writer, value);
+    }
+}
+
+void cbor_writer_init(cbor_writer_t *writer, uint8_t *buf, size_t len)
+{
+    writer->buf = buf;
+    writer->len = len;
+    writer->pos = 0;
+}
+
+void cbor_put_uint(cbor_writer_t *writer, uint32_t value)
+{
+    _put_head(writer, CBOR_UINT, value);
+}
+
+void cbor_put_int(cbor_writer_t *writer, int32_t value)
+{
+    if (value < 0) {
+        /* -1 - n without overflowing on INT32_MIN */
+        _put_head(writer, CBOR_NEGINT, (uint32_t)(-(value + 1)));
+    }
+    else {
+        _put_head(writer, CBOR_UINT, value);
+    }
+}
+
+void cbor_put_text(cbor_writer_t *writer, const char *text)
+{
+    size_t len = strlen(text);
+
+    _put_head(writer, CBOR_TEXT, len);
+    if (writer->pos + len <= writer->len) {
+        memcpy(&writer->buf[writer->pos], text, len);
+    }
+    writer->pos += len;
+}
+
+void cbor_put_array(cbor_writer_t *writer, uint32_t count)
+{
+    _put_head(writer, CBOR_ARRAY, count);
+}
+
+void cbor_put_map(cbor_writer_t *writer, uint32_t count)
+{
+    _put_head(writer, CBOR_MAP, count);
+}
+
+void cbor_put_tag(cbor_writer_t *writer, uint32_t tag)
+{
+    _put_head(writer, CBOR_TAG, tag);
+}
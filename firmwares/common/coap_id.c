@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdio.h>
+
+#include "irq.h"
+#include "random.h"
+#include "xtimer.h"
+#ifdef MODULE_PERIPH_HWRNG
+#include "periph/hwrng.h"
+#endif
+#ifdef MODULE_PERIPH_ADC
+#include "periph/adc.h"
+#endif
+#ifdef MODULE_PERIPH_CPUID
+#include "periph/cpuid.h"
+#endif
+
+#include "coap_id.h"
+
+/* the boot time and the CPU ID are the same on every boot, a rebooted node
+   would draw the message IDs of its previous run again (a message rather
+   than a #warning, RIOT builds with -Werror) */
+#if !defined(MODULE_PERIPH_HWRNG) && !defined(MODULE_PERIPH_ADC)
+#pragma message "coap_id has no entropy source, seeding from the boot time " \
+                "and the CPU ID"
+#endif
+
+#define FNV_PRIME               (16777619U)
+
+static uint16_t next_id;
+
+/* FNV-1a step over the bytes of @p value */
+static uint32_t _mix(uint32_t hash, uint32_t value, unsigned len)
+{
+    for (unsigned i = 0; i < len; i++) {
+        hash = (hash ^ ((value >> (8 * i)) & 0xff)) * FNV_PRIME;
+    }
+    return hash;
+}
+
+#if !defined(MODULE_PERIPH_HWRNG) && defined(MODULE_PERIPH_ADC)
+/* not every ADC converts on 12 bits, the first supported one is used */
+static const adc_res_t adc_res[] = { ADC_RES_12BIT, ADC_RES_10BIT,
+                                     ADC_RES_8BIT };
+
+/* the lowest bits of the conversions and their durations are noise,
+ * returns 0 on success */
+static int _adc_noise(uint32_t *hash)
+{
+    adc_t line = ADC_LINE(COAP_ID_ADC_LINE);
+    unsigned res = 0;
+
+    if (adc_init(line) < 0) {
+        return -1;
+    }
+    while (adc_sample(line, adc_res[res]) < 0) {
+        if (++res == sizeof(adc_res) / sizeof(adc_res[0])) {
+            return -1;
+        }
+    }
+    for (unsigned i = 0; i < COAP_ID_ADC_SAMPLES; i++) {
+        uint32_t start = xtimer_now_usec();
+        int sample = adc_sample(line, adc_res[res]);
+        *hash = _mix(*hash,
+                     (sample & 0x0f) | ((xtimer_now_usec() - start) << 4), 1);
+    }
+    return 0;
+}
+#endif
+
+static uint32_t _seed(void)
+{
+    uint32_t seed;
+
+#ifdef MODULE_PERIPH_HWRNG
+    hwrng_read(&seed, sizeof(seed));
+#else
+    int noise = -1;
+
+    seed = _mix(2166136261U, xtimer_now_usec(), sizeof(uint32_t));
+#ifdef MODULE_PERIPH_ADC
+    noise = _adc_noise(&seed);
+#endif
+    if (noise < 0) {
+        puts("Warning: no entropy source, message IDs may repeat after a "
+             "reboot");
+    }
+#endif
+#ifdef MODULE_PERIPH_CPUID
+    /* nodes sharing a noise pattern still draw different IDs */
+    uint8_t cpuid[CPUID_LEN];
+    cpuid_get(cpuid);
+    for (unsigned i = 0; i < CPUID_LEN; i++) {
+        seed = _mix(seed, cpuid[i], 1);
+    }
+#endif
+    return seed;
+}
+
+void coap_id_init(void)
+{
+    random_init(_seed());
+    next_id = (uint16_t)random_uint32();
+}
+
+uint16_t coap_id_next(void)
+{
+    unsigned state = irq_disable();
+    uint16_t id = next_id++;
+    irq_restore(state);
+    return id;
+}
+
+uint32_t coap_id_random(void)
+{
+    /* the generator state is shared by the sending threads */
+    unsigned state = irq_disable();
+    uint32_t r = random_uint32();
+    irq_restore(state);
+    return r;
+}
+
+void coap_id_token(uint8_t *token, size_t len)
+{
+    while (len > 0) {
+        uint32_t r = coap_id_random();
+        for (unsigned i = 0; (i < sizeof(r)) && (len > 0); i++, len--) {
+            *token++ = r >> (8 * i);
+        }
+    }
+}
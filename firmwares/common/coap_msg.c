@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <coap.h>
+
+#include "coap_msg.h"
+
+unsigned coap_msg_uint_len(uint32_t value)
+{
+    unsigned len = 0;
+
+    for (; value; value >>= 8) {
+        len++;
+    }
+    return len;
+}
+
+uint8_t *coap_msg_put_uint(uint8_t *p, uint32_t value, unsigned len)
+{
+    while (len--) {
+        *p++ = value >> (8 * len);
+    }
+    return p;
+}
+
+uint32_t coap_msg_get_uint(const coap_option_t *opt)
+{
+    uint32_t value = 0;
+
+    for (size_t i = 0; i < opt->buf.len; i++) {
+        value = (value << 8) | opt->buf.p[i];
+    }
+    return value;
+}
+
+int coap_msg_add_option(coap_packet_t *pkt, uint8_t num,
+                        const uint8_t *value, size_t len)
+{
+    int i = pkt->numopts;
+
+    if (pkt->numopts >= MAXOPT) {
+        return -1;
+    }
+    while ((i > 0) && (pkt->opts[i - 1].num > num)) {
+        pkt->opts[i] = pkt->opts[i - 1];
+        i--;
+    }
+    pkt->opts[i].num = num;
+    pkt->opts[i].buf.p = value;
+    pkt->opts[i].buf.len = len;
+    pkt->numopts++;
+    return 0;
+}
+
+int coap_msg_reply(coap_rw_buffer_t *scratch, const coap_packet_t *req,
+                   coap_packet_t *rsp, coap_responsecode_t code)
+{
+    int res = coap_make_response(scratch, rsp, NULL, 0,
+                                 req->hdr.id[0], req->hdr.id[1], &req->tok,
+                                 code, COAP_CONTENTTYPE_TEXT_PLAIN);
+    /* no payload, so no Content-Format */
+    rsp->numopts = 0;
+    return res;
+}
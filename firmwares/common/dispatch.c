@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <coap.h>
+
+#include "coap_msg.h"
+#include "dispatch.h"
+#include "stats.h"
+
+#define FNV_OFFSET_BASIS        (2166136261U)
+#define FNV_PRIME               (16777619U)
+
+#define METHODS                 (4)     /* GET, POST, PUT and DELETE */
+#define NO_ENDPOINT             (0xff)
+
+typedef struct {
+    const coap_endpoint_path_t *path;   /* NULL for a free slot */
+    uint32_t hash;
+    uint8_t methods;                    /* bit n - 1 set if method n served */
+    uint8_t endpoint[METHODS];          /* endpoint index of each method */
+} slot_t;
+
+static slot_t table[DISPATCH_TABLE_SIZE];
+static int ready = 0;
+
+static uint32_t _hash(uint32_t hash, const uint8_t *p, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * FNV_PRIME;
+    }
+    /* segment separator, so that ("a", "bc") and ("ab", "c") differ */
+    return (hash ^ '/') * FNV_PRIME;
+}
+
+static uint32_t _hash_path(const coap_endpoint_path_t *path)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (int i = 0; i < path->count; i++) {
+        hash = _hash(hash, (const uint8_t *)path->elems[i],
+                     strlen(path->elems[i]));
+    }
+    return hash;
+}
+
+static int _same_path(const coap_endpoint_path_t *a,
+                      const coap_endpoint_path_t *b)
+{
+    if (a->count != b->count) {
+        return 0;
+    }
+    for (int i = 0; i < a->count; i++) {
+        if (strcmp(a->elems[i], b->elems[i]) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int dispatch_init(void)
+{
+    memset(table, 0, sizeof(table));
+
+    for (unsigned e = 0; endpoints[e].handler != NULL; e++) {
+        const coap_endpoint_t *ep = &endpoints[e];
+        uint32_t hash = _hash_path(ep->path);
+        unsigned i = hash & (DISPATCH_TABLE_SIZE - 1);
+        unsigned probes = 0;
+
+        if ((ep->method < 1) || (ep->method > METHODS) ||
+            (e >= NO_ENDPOINT)) {
+            puts("Error: endpoint cannot be dispatched");
+            return -1;
+        }
+
+        /* linear probing, stopping on the slot of the same path */
+        while ((table[i].path != NULL) &&
+               ((table[i].hash != hash) ||
+                !_same_path(table[i].path, ep->path))) {
+            if (++probes == DISPATCH_TABLE_SIZE) {
+                puts("Error: dispatch table full");
+                return -1;
+            }
+            i = (i + 1) & (DISPATCH_TABLE_SIZE - 1);
+        }
+
+        slot_t *slot = &table[i];
+        if (slot->path == NULL) {
+            slot->path = ep->path;
+            slot->hash = hash;
+            memset(slot->endpoint, NO_ENDPOINT, sizeof(slot->endpoint));
+        }
+        /* the first endpoint listed for a method wins, as with a scan */
+        if (!(slot->methods & (1 << (ep->method - 1)))) {
+            slot->methods |= 1 << (ep->method - 1);
+            slot->endpoint[ep->method - 1] = e;
+        }
+    }
+
+    ready = 1;
+    return 0;
+}
+
+/* whether the Uri-Path options @p opt match @p path */
+static int _match(const coap_endpoint_path_t *path, const coap_option_t *opt,
+                  uint8_t count)
+{
+    if (path->count != count) {
+        return 0;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        if ((opt[i].buf.len != strlen(path->elems[i])) ||
+            (memcmp(opt[i].buf.p, path->elems[i], opt[i].buf.len) != 0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static const slot_t *_lookup(const coap_packet_t *pkt)
+{
+    uint8_t count;
+    const coap_option_t *opt = coap_findOptions(pkt, COAP_OPTION_URI_PATH,
+                                                &count);
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    if ((opt == NULL) || (count > MAX_SEGMENTS)) {
+        return NULL;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        hash = _hash(hash, opt[i].buf.p, opt[i].buf.len);
+    }
+
+    unsigned i = hash & (DISPATCH_TABLE_SIZE - 1);
+    for (unsigned probes = 0; probes < DISPATCH_TABLE_SIZE; probes++) {
+        const slot_t *slot = &table[i];
+        if (slot->path == NULL) {
+            return NULL;
+        }
+        if ((slot->hash == hash) && _match(slot->path, opt, count)) {
+            return slot;
+        }
+        i = (i + 1) & (DISPATCH_TABLE_SIZE - 1);
+    }
+    return NULL;
+}
+
+/* run the handler of @p ep, timed */
+static int _handle(const coap_endpoint_t *ep, coap_rw_buffer_t *scratch,
+                   const coap_packet_t *inpkt, coap_packet_t *outpkt)
+{
+    uint32_t start = stats_now();
+    int res = ep->handler(scratch, inpkt, outpkt,
+                          inpkt->hdr.id[0], inpkt->hdr.id[1]);
+    stats_record(STATS_HANDLER, start);
+    return res;
+}
+
+int dispatch_request(coap_rw_buffer_t *scratch, const coap_packet_t *inpkt,
+                     coap_packet_t *outpkt)
+{
+    uint8_t method = inpkt->hdr.code;
+
+    if (!ready) {
+        return coap_handle_req(scratch, inpkt, outpkt);
+    }
+
+    uint32_t start = stats_now();
+    const slot_t *slot = _lookup(inpkt);
+    stats_record(STATS_DISPATCH, start);
+    if (slot == NULL) {
+        return coap_msg_reply(scratch, inpkt, outpkt, COAP_RSPCODE_NOT_FOUND);
+    }
+    if ((method < 1) || (method > METHODS) ||
+        !(slot->methods & (1 << (method - 1)))) {
+        return coap_msg_reply(scratch, inpkt, outpkt,
+                              COAP_RSPCODE_METHOD_NOT_ALLOWED);
+    }
+
+    return _handle(&endpoints[slot->endpoint[method - 1]], scratch, inpkt,
+                   outpkt);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "fixed.h"
+
+const fixed_conv_t fixed_lsm303dlhc_temp = { 5, 6, -1 };    /* 10 / 128 */
+const fixed_conv_t fixed_at30tse_temp = { 5, 2, -1 };       /* 10 / 8 */
+const fixed_conv_t fixed_bmp180_pressure = { 1, 0, -2 };
+
+const uint32_t fixed_pow10[FIXED_POW10_MAX + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000
+};
+
+int32_t fixed_convert(int32_t raw, const fixed_conv_t *conv)
+{
+    int32_t product = raw * conv->mul;
+
+    if (conv->shift == 0) {
+        return product;
+    }
+    /* round half away from zero, shifting magnitudes only */
+    int32_t half = (int32_t)1 << (conv->shift - 1);
+    if (product < 0) {
+        return -((-product + half) >> conv->shift);
+    }
+    return (product + half) >> conv->shift;
+}
+
+int fixed_fmt(char *buf, size_t len, int32_t value, int8_t scale)
+{
+    /* magnitude, also right for INT32_MIN */
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+    unsigned decimals = (scale < 0) ? -scale : 0;
+    char digits[10];
+    unsigned n = 0;
+
+    if ((scale > FIXED_POW10_MAX) || (decimals > FIXED_POW10_MAX)) {
+        return -1;
+    }
+    if (scale > 0) {
+        if (magnitude > UINT32_MAX / fixed_pow10[scale]) {
+            return -1;
+        }
+        magnitude *= fixed_pow10[scale];
+    }
+
+    uint32_t int_part = magnitude / fixed_pow10[decimals];
+    uint32_t frac = magnitude % fixed_pow10[decimals];
+
+    /* integer digits, least significant first */
+    do {
+        digits[n++] = '0' + int_part % 10;
+        int_part /= 10;
+    } while (int_part > 0);
+
+    size_t res = (value < 0) + n + ((decimals > 0) ? 1 + decimals : 0);
+    if (res >= len) {
+        return -1;
+    }
+
+    char *p = buf;
+    if (value < 0) {
+        *p++ = '-';
+    }
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    if (decimals > 0) {
+        *p++ = '.';
+        for (unsigned i = decimals; i > 0; i--) {
+            p[i - 1] = '0' + frac % 10;
+            frac /= 10;
+        }
+        p += decimals;
+    }
+    *p = '\0';
+    return res;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "irq.h"
+#include "msg.h"
+#include "mutex.h"
+#include "thread.h"
+
+#include "i2c_bus.h"
+
+#define I2C_BUS_MSG_WAKEUP      (0x4901)    /* a request was queued */
+
+static char i2c_bus_stack[I2C_BUS_STACKSIZE];
+static msg_t i2c_bus_queue[I2C_BUS_QUEUE_SIZE];
+static kernel_pid_t i2c_bus_pid = KERNEL_PID_UNDEF;
+
+/* requests in submission order */
+static i2c_bus_req_t *head = NULL;
+static i2c_bus_req_t *tail = NULL;
+
+/* waiter of i2c_bus_run(), the request first so the callback can find it */
+typedef struct {
+    i2c_bus_req_t req;
+    mutex_t lock;
+} i2c_bus_wait_t;
+
+void i2c_bus_req_init(i2c_bus_req_t *req, i2c_bus_op_t op, void *arg,
+                      i2c_bus_cb_t done)
+{
+    req->next = NULL;
+    req->op = op;
+    req->arg = arg;
+    req->done = done;
+    req->pid = KERNEL_PID_UNDEF;
+    req->res = 0;
+}
+
+/* to be called with interrupts disabled */
+static int _queued(const i2c_bus_req_t *req)
+{
+    for (const i2c_bus_req_t *r = head; r != NULL; r = r->next) {
+        if (r == req) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int i2c_bus_submit(i2c_bus_req_t *req)
+{
+    msg_t msg;
+
+    if (i2c_bus_pid == KERNEL_PID_UNDEF) {
+        return -ENODEV;
+    }
+
+    unsigned state = irq_disable();
+    if (_queued(req)) {
+        irq_restore(state);
+        return -EBUSY;
+    }
+    req->next = NULL;
+    if (tail == NULL) {
+        head = req;
+    }
+    else {
+        tail->next = req;
+    }
+    tail = req;
+    irq_restore(state);
+
+    /* the worker drains the whole queue before waiting again, a wakeup
+       lost to a full message queue is never the only one pending */
+    msg.type = I2C_BUS_MSG_WAKEUP;
+    msg_try_send(&msg, i2c_bus_pid);
+    return 0;
+}
+
+static void _wake_waiter(i2c_bus_req_t *req)
+{
+    mutex_unlock(&((i2c_bus_wait_t *)req)->lock);
+}
+
+int i2c_bus_run(i2c_bus_op_t op, void *arg)
+{
+    if ((i2c_bus_pid == KERNEL_PID_UNDEF) ||
+        (thread_getpid() == i2c_bus_pid)) {
+        return op(arg);
+    }
+
+    i2c_bus_wait_t wait;
+    i2c_bus_req_init(&wait.req, op, arg, _wake_waiter);
+    mutex_init(&wait.lock);
+    mutex_lock(&wait.lock);
+    i2c_bus_submit(&wait.req);
+    /* released by the worker once the transaction is done */
+    mutex_lock(&wait.lock);
+    return wait.req.res;
+}
+
+static i2c_bus_req_t *_pop(void)
+{
+    unsigned state = irq_disable();
+    i2c_bus_req_t *req = head;
+    if (req != NULL) {
+        head = req->next;
+        if (head == NULL) {
+            tail = NULL;
+        }
+        req->next = NULL;
+    }
+    irq_restore(state);
+    return req;
+}
+
+static void *_i2c_bus_thread(void *arg)
+{
+    (void)arg;
+    msg_t msg;
+
+    /* set here too, the thread runs before thread_create() returns */
+    i2c_bus_pid = thread_getpid();
+    msg_init_queue(i2c_bus_queue, I2C_BUS_QUEUE_SIZE);
+
+    for (;;) {
+        i2c_bus_req_t *req;
+
+        while ((req = _pop()) != NULL) {
+            req->res = req->op(req->arg);
+            /* the request may be reused as soon as its completion is
+               reported, read the pid first */
+            kernel_pid_t pid = req->pid;
+            if (req->done != NULL) {
+                req->done(req);
+            }
+            if (pid != KERNEL_PID_UNDEF) {
+                msg.type = I2C_BUS_MSG_DONE;
+                msg.content.ptr = req;
+                msg_try_send(&msg, pid);
+            }
+        }
+        msg_receive(&msg);
+    }
+
+    return NULL;
+}
+
+kernel_pid_t i2c_bus_start(void)
+{
+    i2c_bus_pid = thread_create(i2c_bus_stack, sizeof(i2c_bus_stack),
+                                I2C_BUS_PRIO, THREAD_CREATE_STACKTEST,
+                                _i2c_bus_thread, NULL, "I2C bus thread");
+    if (i2c_bus_pid == -EINVAL || i2c_bus_pid == -EOVERFLOW) {
+        puts("Error: failed to create I2C bus thread");
+        i2c_bus_pid = KERNEL_PID_UNDEF;
+        return -EINVAL;
+    }
+    return i2c_bus_pid;
+}
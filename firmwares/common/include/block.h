@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * CoAP block-wise transfers (RFC 7959).
+ *
+ * Responses larger than a block are served in Block2 slices, requests sent
+ * with Block1 are reassembled before reaching their handler, and telemetry
+ * pushes larger than a block are streamed as Block1 POSTs. Blocks are kept
+ * small enough for a message to fit in a single 802.15.4 frame.
+ */
+
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COAP_OPTION_BLOCK2      (23)
+#define COAP_OPTION_BLOCK1      (27)
+
+#define COAP_RSPCODE_CONTINUE                   MAKE_RSPCODE(2, 31)
+#define COAP_RSPCODE_BAD_OPTION                 MAKE_RSPCODE(4, 2)
+#define COAP_RSPCODE_REQUEST_ENTITY_INCOMPLETE  MAKE_RSPCODE(4, 8)
+#define COAP_RSPCODE_REQUEST_ENTITY_TOO_LARGE   MAKE_RSPCODE(4, 13)
+
+#ifndef BLOCK_SZX
+#define BLOCK_SZX               (1)     /* 32-byte blocks */
+#endif
+#define BLOCK_SIZE(szx)         (16U << (szx))
+
+#ifndef BLOCK1_BUF_SIZE
+#define BLOCK1_BUF_SIZE         (256)   /* largest reassembled request */
+#endif
+
+#ifndef BLOCK1_TIMEOUT
+#define BLOCK1_TIMEOUT          (30000000U) /* idle transfer given up (us) */
+#endif
+
+#define BLOCK_OPT_MAX_LEN       (3)
+
+typedef struct {
+    uint32_t num;           /* block number */
+    uint8_t more;           /* more blocks follow */
+    uint8_t szx;            /* block size exponent, size is 2^(szx + 4) */
+} block_opt_t;
+
+/* Parse option @p num (Block1 or Block2) of @p pkt into @p block.
+ * Returns 0 on success, -1 if @p pkt has no such option. */
+int block_get(const coap_packet_t *pkt, uint8_t num, block_opt_t *block);
+
+/* Encode @p block as an option value into @p buf, which holds at least
+ * BLOCK_OPT_MAX_LEN bytes. Returns the value length. */
+size_t block_put(uint8_t *buf, const block_opt_t *block);
+
+/* Collect the Block1 payload of @p req. A single transfer is reassembled
+ * at a time, from the client endpoint and token of its block 0: other
+ * clients get 5.03 until it completes or stays idle for BLOCK1_TIMEOUT.
+ * A repeat of the last block received is answered again. Returns 0 once
+ * the request is complete, its payload then being the reassembled one, or
+ * 1 if @p rsp holds the answer to send instead of handling the request
+ * (2.31 Continue or an error). */
+int block1_receive(coap_rw_buffer_t *scratch, coap_packet_t *req,
+                   coap_packet_t *rsp);
+
+/* Slice the payload of @p rsp to the block asked for by @p req, adding the
+ * Block1 and Block2 options needed by a block-wise exchange. */
+void block_apply(const coap_packet_t *req, coap_packet_t *rsp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOCK_H */
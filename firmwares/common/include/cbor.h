@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Minimal CBOR (RFC 7049) writer covering what the telemetry encoders need:
+ * integers, text strings, arrays, maps and tags.
+ */
+
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CBOR_TAG_DECIMAL_FRACTION   (4)
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t pos;     /* bytes needed so far, may exceed len on overflow */
+} cbor_writer_t;
+
+void cbor_writer_init(cbor_writer_t *writer, uint8_t *buf, size_t len);
+
+void cbor_put_uint(cbor_writer_t *writer, uint32_t value);
+void cbor_put_int(cbor_writer_t *writer, int32_t value);
+void cbor_put_text(cbor_writer_t *writer, const char *text);
+void cbor_put_array(cbor_writer_t *writer, uint32_t count);
+void cbor_put_map(cbor_writer_t *writer, uint32_t count);
+void cbor_put_tag(cbor_writer_t *writer, uint32_t tag);
+
+/* Number of bytes written, or -1 if the buffer was too small. */
+static inline int cbor_writer_len(const cbor_writer_t *writer)
+{
+    return (writer->pos > writer->len) ? -1 : (int)writer->pos;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CBOR_H */
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * CoAP message ID and token generator.
+ *
+ * Message IDs continue from a random value drawn at boot, so that the
+ * requests of a rebooted node do not reuse the IDs of its previous run and
+ * get dropped as duplicates by the broker. The generator is seeded from the
+ * hardware RNG when the board has one, otherwise from the noise of
+ * COAP_ID_ADC_SAMPLES conversions of ADC line COAP_ID_ADC_LINE, and mixed
+ * with the CPU ID so that nodes differ. A board with neither source only
+ * mixes the boot time, nearly the same on every boot, with the CPU ID: it
+ * builds with a warning and prints one at boot. Tokens are random.
+ */
+
+#ifndef COAP_ID_H
+#define COAP_ID_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef COAP_ID_ADC_LINE
+#define COAP_ID_ADC_LINE        (0)     /* a floating or noisy input */
+#endif
+
+#ifndef COAP_ID_ADC_SAMPLES
+#define COAP_ID_ADC_SAMPLES     (128)   /* conversions mixed in the seed */
+#endif
+
+/* Seed the generator and draw the first message ID. */
+void coap_id_init(void);
+
+/* Return the next message ID, from any thread. */
+uint16_t coap_id_next(void);
+
+/* Return a random number from the seeded generator, from any thread. */
+uint32_t coap_id_random(void);
+
+/* Fill @p token with @p len random bytes. */
+void coap_id_token(uint8_t *token, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAP_ID_H */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * CoAP message helpers shared by the server modules: uint option values
+ * (RFC 7252, section 3.2), option insertion into a packet built by
+ * microcoap, and empty replies.
+ */
+
+#ifndef COAP_MSG_H
+#define COAP_MSG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of bytes encoding @p value as a uint option, 0 for 0. */
+unsigned coap_msg_uint_len(uint32_t value);
+
+/* Write the @p len low bytes of @p value at @p p, most significant first.
+ * Returns the end of the value. */
+uint8_t *coap_msg_put_uint(uint8_t *p, uint32_t value, unsigned len);
+
+/* Value of the uint option @p opt. */
+uint32_t coap_msg_get_uint(const coap_option_t *opt);
+
+/* Insert option @p num with @p len bytes of @p value in @p pkt, keeping the
+ * options sorted. @p value must live until @p pkt is built. Returns 0 on
+ * success, -1 if @p pkt already has MAXOPT options. */
+int coap_msg_add_option(coap_packet_t *pkt, uint8_t num,
+                        const uint8_t *value, size_t len);
+
+/* Answer @p req with @p code and neither options nor payload. Returns the
+ * result of coap_make_response(). */
+int coap_msg_reply(coap_rw_buffer_t *scratch, const coap_packet_t *req,
+                   coap_packet_t *rsp, coap_responsecode_t code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAP_MSG_H */
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Hashed CoAP request dispatch.
+ *
+ * Replaces the linear scan of coap_handle_req() over the endpoints array:
+ * the table maps the FNV-1a hash of each path to its endpoints, one per
+ * method, with a bitmap of the methods served. A request hashes its
+ * Uri-Path options once and its path is compared with a single candidate
+ * at most, so unknown paths get 4.04 and unsupported methods 4.05 without
+ * scanning the endpoints.
+ */
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <stdint.h>
+#include <coap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef DISPATCH_TABLE_SIZE
+#define DISPATCH_TABLE_SIZE     (32)    /* slots, a power of 2 */
+#endif
+
+#define COAP_RSPCODE_METHOD_NOT_ALLOWED MAKE_RSPCODE(4, 5)
+
+/* Build the table from the endpoints array. Returns 0 on success, -1 if
+ * the table is too small, in which case requests fall back to
+ * coap_handle_req(). */
+int dispatch_init(void);
+
+/* Handle @p inpkt like coap_handle_req(), building the reply in @p outpkt. */
+int dispatch_request(coap_rw_buffer_t *scratch, const coap_packet_t *inpkt,
+                     coap_packet_t *outpkt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISPATCH_H */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Integer fixed-point helpers for sensor values.
+ *
+ * A value is an integer in units of 10^scale, as in telemetry_reading_t.
+ * Raw sensor counts are turned into values by a conversion: a multiplier and
+ * a binary shift, rounded to nearest, so the common 1/2^n LSB sizes cost a
+ * multiply and a shift. Formatting goes through a table of powers of ten, so
+ * neither needs floating point nor printf_float.
+ */
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FIXED_POW10_MAX         (9)     /* largest exponent in the table */
+
+/* raw count to value: round(raw * mul / 2^shift), in units of 10^scale */
+typedef struct {
+    int32_t mul;
+    uint8_t shift;
+    int8_t scale;
+} fixed_conv_t;
+
+/* LSM303DLHC temperature, 1/128 °C per LSB, to 0.1 °C */
+extern const fixed_conv_t fixed_lsm303dlhc_temp;
+/* AT30TSE75x temperature, 1/8 °C per LSB of the 11-bit value, to 0.1 °C */
+extern const fixed_conv_t fixed_at30tse_temp;
+/* BMP180 pressure, 1 Pa per LSB, to hPa with two decimals */
+extern const fixed_conv_t fixed_bmp180_pressure;
+
+extern const uint32_t fixed_pow10[FIXED_POW10_MAX + 1];
+
+/* Convert the raw count @p raw with @p conv. @p raw * mul must fit in 32
+ * bits. */
+int32_t fixed_convert(int32_t raw, const fixed_conv_t *conv);
+
+/* Format @p value in units of 10^@p scale as a decimal number, e.g. "-21.5",
+ * NUL-terminated. Returns the string length or -1 if it does not fit. */
+int fixed_fmt(char *buf, size_t len, int32_t value, int8_t scale);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIXED_H */
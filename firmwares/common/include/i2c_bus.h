@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * I2C transaction queue: serializes the sensor reads of all threads.
+ *
+ * A transaction is a function driving the bus (a driver read, a transfer),
+ * queued with i2c_bus_submit() and run by a worker thread in submission
+ * order, so reads from the sampling job and the CoAP server never interleave
+ * on the bus. Completion is reported by a callback run by the worker, or by
+ * an I2C_BUS_MSG_DONE message to the submitting thread, and i2c_bus_run()
+ * waits for it.
+ *
+ * RIOT mutexes have no priority inheritance, so the worker runs above every
+ * thread submitting transactions instead (priority ceiling): a transaction
+ * started on behalf of a low priority thread cannot be preempted by a
+ * medium priority one, and a client waits at most for the transactions
+ * queued before its own, the bound priority inheritance would give.
+ */
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include "kernel_types.h"
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef I2C_BUS_STACKSIZE
+#define I2C_BUS_STACKSIZE       (THREAD_STACKSIZE_DEFAULT)
+#endif
+
+#ifndef I2C_BUS_PRIO
+#define I2C_BUS_PRIO            (THREAD_PRIORITY_MAIN - 2)  /* above the
+                                                              scheduler */
+#endif
+
+#define I2C_BUS_QUEUE_SIZE      (4)
+#define I2C_BUS_MSG_DONE        (0x4902)    /* content.ptr is the request */
+
+typedef struct i2c_bus_req i2c_bus_req_t;
+
+typedef int (*i2c_bus_op_t)(void *arg);
+typedef void (*i2c_bus_cb_t)(i2c_bus_req_t *req);
+
+struct i2c_bus_req {
+    i2c_bus_req_t *next;
+    i2c_bus_op_t op;        /* transaction, run by the worker */
+    void *arg;
+    i2c_bus_cb_t done;      /* run by the worker after @p op, or NULL */
+    kernel_pid_t pid;       /* sent I2C_BUS_MSG_DONE, or KERNEL_PID_UNDEF */
+    int res;                /* value returned by @p op */
+};
+
+/* Prepare @p req to run @p op, reporting its completion to @p done. */
+void i2c_bus_req_init(i2c_bus_req_t *req, i2c_bus_op_t op, void *arg,
+                      i2c_bus_cb_t done);
+
+/* Queue @p req without waiting for it, from any thread. @p req must stay
+ * valid until its completion. Returns 0 on success, -ENODEV if the worker
+ * is not running or -EBUSY if @p req is already queued. */
+int i2c_bus_submit(i2c_bus_req_t *req);
+
+/* Run @p op from the worker and wait for it, or run it in place from the
+ * worker itself and before the worker is started. Returns its result. */
+int i2c_bus_run(i2c_bus_op_t op, void *arg);
+
+/* Create the worker thread. Returns its pid or a negative errno. */
+kernel_pid_t i2c_bus_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* I2C_BUS_H */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * /.well-known/core resource discovery (RFC 6690).
+ *
+ * The endpoint table is constant, so its link-format description is written
+ * once, on the first discovery request, and later requests are answered
+ * straight from that cache. Documents larger than a block are served in
+ * Block2 slices, so the cache is not bounded by the response buffer.
+ */
+
+#ifndef LINK_FORMAT_H
+#define LINK_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LINK_FORMAT_MAX_LEN
+#define LINK_FORMAT_MAX_LEN     (512)   /* size of the cached document */
+#endif
+
+/* Write the link-format description of @p endpoints into @p buf, one entry
+ * per path having core attributes. Stops at the last entry that fits and
+ * logs the truncation. Returns the document length. */
+size_t link_format_build(const coap_endpoint_t *endpoints,
+                         char *buf, size_t len);
+
+/* Answer a GET on /.well-known/core with the cached description of
+ * @p endpoints, building it on first use. */
+int link_format_response(coap_rw_buffer_t *scratch,
+                         const coap_packet_t *inpkt,
+                         coap_packet_t *outpkt,
+                         uint8_t id_hi, uint8_t id_lo,
+                         const coap_endpoint_t *endpoints);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINK_FORMAT_H */
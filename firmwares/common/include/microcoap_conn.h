@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * CoAP server dispatching the requests received on port 5683 to the
+ * endpoints array of the firmware.
+ */
+
+#ifndef MICROCOAP_CONN_H
+#define MICROCOAP_CONN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Starts a blocking and never-returning loop dispatching CoAP requests.
+ *
+ * When using gnrc, make sure the calling thread has an initialized msg queue.
+ */
+void microcoap_server_loop(void);
+
+/* Copy the sender of the request being handled, to answer it later from
+ * another thread. @p addr holds 16 bytes. */
+void microcoap_remote(uint8_t *addr, size_t *addr_len, uint16_t *port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MICROCOAP_CONN_H */
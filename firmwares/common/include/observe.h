@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * CoAP Observe (RFC 7641) for sensor resources.
+ *
+ * A GET carrying Observe: 0 registers the client in a bounded observer table,
+ * Observe: 1, a plain GET with the same token or a RST to a notification
+ * removes it. The sampling threads hand every new sample to observe_notify(),
+ * which sends a NON 2.05 to each observer whose values moved by at least the
+ * threshold it asked for with a "th=<n>" Uri-Query (in units of the last
+ * digit of the resource, any change by default).
+ *
+ * As RFC 7641 section 4.5 requires, an observer gets a CON notification at
+ * least every OBSERVE_CON_INTERVAL seconds, changed or not, to check that it
+ * is still interested. It is resent with the exponential backoff of
+ * RFC 7252 and the observer is dropped if it never acknowledges it. A single
+ * CON notification is in flight at a time, the other observers due for one
+ * getting theirs once it is answered.
+ */
+
+#ifndef OBSERVE_H
+#define OBSERVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coap.h>
+
+#include "telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef OBSERVE_MAX_OBSERVERS
+#define OBSERVE_MAX_OBSERVERS   (4)     /* size of the observer table */
+#endif
+
+#ifndef OBSERVE_VALUES_MAX
+#define OBSERVE_VALUES_MAX      (9)     /* readings compared per resource */
+#endif
+
+#ifndef OBSERVE_CON_INTERVAL
+#define OBSERVE_CON_INTERVAL    (86400U)    /* s, 24 hours */
+#endif
+
+#define OBSERVE_ACK_TIMEOUT     (2000000U)  /* us */
+#define OBSERVE_MAX_RETRANSMIT  (4)
+
+#define OBSERVE_SRC_PORT        (5683)  /* notifications leave the server port */
+#define OBSERVE_BUF_SIZE        (128)   /* size of a complete notification */
+#define OBSERVE_TOKEN_MAX_LEN   (8)
+
+/* Remember the sender of the request being handled by the server loop. */
+void observe_set_remote(const uint8_t *addr, size_t addr_len, uint16_t port);
+
+/* Drop the observer whose last notification is rejected by RST @p pkt. */
+void observe_reset(const coap_packet_t *pkt);
+
+/* Match the ACK @p pkt with the CON notification in flight. */
+void observe_ack(const coap_packet_t *pkt);
+
+/* Answer a GET on @p resource like telemetry_make_response() and handle its
+ * Observe option, registering or removing the requesting client. */
+int observe_make_response(coap_rw_buffer_t *scratch,
+                          const coap_packet_t *inpkt,
+                          coap_packet_t *outpkt,
+                          uint8_t id_hi, uint8_t id_lo,
+                          const char *resource,
+                          const telemetry_reading_t *readings,
+                          unsigned count);
+
+/* Notify the observers of @p resource of a new sample. */
+void observe_notify(const char *resource,
+                    const telemetry_reading_t *readings, unsigned count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OBSERVE_H */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Report-on-change: decides which readings are worth pushing to the broker.
+ *
+ * A reading is reported when it moved from the last reported value of its
+ * metric by more than the deadband of the metric, the larger of an absolute
+ * value and a fraction of the last report. Reports of a metric are at least
+ * min_interval apart, and an unchanged metric is still reported every
+ * max_interval as a heartbeat. Readings of metrics without an entry are
+ * always reported.
+ *
+ * The configuration is read and written as text, as on the /report
+ * resource: "min=<s> max=<s> <metric>=<n> <metric>%=<p>", with intervals in
+ * seconds, <n> in units of the last digit of the metric and <p> a percentage
+ * with at most one decimal. Omitted settings are left unchanged.
+ */
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mutex.h"
+#include "telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef REPORT_MIN_INTERVAL
+#define REPORT_MIN_INTERVAL     (0U)            /* no rate limit */
+#endif
+
+#ifndef REPORT_MAX_INTERVAL
+#define REPORT_MAX_INTERVAL     (300000000U)    /* heartbeat every 5 minutes */
+#endif
+
+typedef struct {
+    const char *name;       /* metric name of the readings */
+    int32_t abs;            /* absolute deadband, in units of the value */
+    uint16_t permille;      /* relative deadband, in 0.1 % of the last report */
+    uint8_t reported;       /* whether last holds a reported value */
+    int32_t last;           /* last reported value */
+    uint32_t last_time;     /* time of the last report (us) */
+} report_metric_t;
+
+typedef struct {
+    report_metric_t *metrics;
+    unsigned count;
+    uint32_t min_interval;  /* shortest time between two reports (us) */
+    uint32_t max_interval;  /* heartbeat of unchanged metrics (us), 0 never */
+    mutex_t lock;           /* the configuration is changed over CoAP */
+} report_t;
+
+/* entry of a report_metric_t array with its default deadbands */
+#define REPORT_METRIC(name, abs, permille)  { (name), (abs), (permille), 0, 0, 0 }
+
+/* Prepare @p report to filter the readings of @p count @p metrics, with the
+ * default REPORT_MIN_INTERVAL and REPORT_MAX_INTERVAL. */
+void report_init(report_t *report, report_metric_t *metrics, unsigned count);
+
+/* Whether @p reading should be pushed. If so it becomes the last report of
+ * its metric. */
+int report_changed(report_t *report, const telemetry_reading_t *reading);
+
+/* Write the configuration of @p report as text in @p buf. Returns its
+ * length, or -1 if it does not fit in @p len bytes. */
+int report_config_print(report_t *report, char *buf, size_t len);
+
+/* Apply the @p len bytes of text configuration in @p buf. Returns 0 on
+ * success, -1 if it is malformed, in which case nothing is changed. */
+int report_config_parse(report_t *report, const char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REPORT_H */
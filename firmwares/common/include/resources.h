@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * CoAP resources shared by all firmwares: /.well-known/core, the node
+ * identity (/name, /os, /board, /mcu), the user LED (/led), the timing of
+ * the sampling job (/sampling), the report-on-change settings (/report) and
+ * the runtime statistics (/stats).
+ *
+ * microcoap dispatches requests from a single endpoints array, so a firmware
+ * registers these resources by listing the RESOURCES_* entries first in its
+ * own array, followed by its sensor resources.
+ */
+
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <stdint.h>
+#include <coap.h>
+
+#include "report.h"
+#include "scheduler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LED0_ACTIVE_LOW
+#define LED0_ACTIVE_LOW         (1)     /* LED0 is lit when its pin is low */
+#endif
+
+#ifndef RESOURCES_LED_HOLDOFF
+#define RESOURCES_LED_HOLDOFF   (50000U)    /* LED changes pushed together */
+#endif
+
+/* /.well-known/core and the node identity */
+#define RESOURCES_COMMON \
+    { COAP_METHOD_GET,  resources_get_well_known_core, \
+      &resources_path_well_known_core, "ct=40" }, \
+    { COAP_METHOD_GET,  resources_get_name, \
+      &resources_path_name,     "ct=0" }, \
+    { COAP_METHOD_GET,  resources_get_os, \
+      &resources_path_os,       "ct=0" }, \
+    { COAP_METHOD_GET,  resources_get_board, \
+      &resources_path_board,    "ct=0" }, \
+    { COAP_METHOD_GET,  resources_get_mcu, \
+      &resources_path_mcu,      "ct=0" }
+
+/* the user LED, its changes are pushed to the broker from the scheduler
+ * thread, after the reply */
+#define RESOURCES_LED \
+    { COAP_METHOD_GET,  resources_get_led, \
+      &resources_path_led,      "ct=0" }, \
+    { COAP_METHOD_PUT,  resources_put_led, \
+      &resources_path_led,      "ct=0" }
+
+/* start delay statistics of the sampling job */
+#define RESOURCES_SAMPLING \
+    { COAP_METHOD_GET,  resources_get_sampling, \
+      &resources_path_sampling, "ct=\"0 60\"" }
+
+/* deadbands and intervals of the pushed readings, see report.h */
+#define RESOURCES_REPORT \
+    { COAP_METHOD_GET,  resources_get_report, \
+      &resources_path_report,   "ct=0" }, \
+    { COAP_METHOD_PUT,  resources_put_report, \
+      &resources_path_report,   "ct=0" }
+
+/* request counters, timings and stack usage, see stats.h */
+#define RESOURCES_STATS \
+    { COAP_METHOD_GET,  resources_get_stats, \
+      &resources_path_stats,    "ct=60" }
+
+/* marks the end of the endpoints array */
+#define RESOURCES_END \
+    { (coap_method_t)0, NULL, NULL, NULL }
+
+extern const coap_endpoint_path_t resources_path_well_known_core;
+extern const coap_endpoint_path_t resources_path_name;
+extern const coap_endpoint_path_t resources_path_os;
+extern const coap_endpoint_path_t resources_path_board;
+extern const coap_endpoint_path_t resources_path_mcu;
+extern const coap_endpoint_path_t resources_path_led;
+extern const coap_endpoint_path_t resources_path_sampling;
+extern const coap_endpoint_path_t resources_path_report;
+extern const coap_endpoint_path_t resources_path_stats;
+
+/* Set the application name served on /name, the job whose timing is served
+ * on /sampling and the report-on-change settings served on /report (NULL if
+ * the firmware does not sample or reports every reading). */
+void resources_init(const char *name, const scheduler_job_t *sampling,
+                    report_t *report);
+
+int resources_get_well_known_core(coap_rw_buffer_t *scratch,
+                                  const coap_packet_t *inpkt,
+                                  coap_packet_t *outpkt,
+                                  uint8_t id_hi, uint8_t id_lo);
+
+int resources_get_name(coap_rw_buffer_t *scratch,
+                       const coap_packet_t *inpkt,
+                       coap_packet_t *outpkt,
+                       uint8_t id_hi, uint8_t id_lo);
+
+int resources_get_os(coap_rw_buffer_t *scratch,
+                     const coap_packet_t *inpkt,
+                     coap_packet_t *outpkt,
+                     uint8_t id_hi, uint8_t id_lo);
+
+int resources_get_board(coap_rw_buffer_t *scratch,
+                        const coap_packet_t *inpkt,
+                        coap_packet_t *outpkt,
+                        uint8_t id_hi, uint8_t id_lo);
+
+int resources_get_mcu(coap_rw_buffer_t *scratch,
+                      const coap_packet_t *inpkt,
+                      coap_packet_t *outpkt,
+                      uint8_t id_hi, uint8_t id_lo);
+
+int resources_get_led(coap_rw_buffer_t *scratch,
+                      const coap_packet_t *inpkt,
+                      coap_packet_t *outpkt,
+                      uint8_t id_hi, uint8_t id_lo);
+
+int resources_put_led(coap_rw_buffer_t *scratch,
+                      const coap_packet_t *inpkt,
+                      coap_packet_t *outpkt,
+                      uint8_t id_hi, uint8_t id_lo);
+
+int resources_get_sampling(coap_rw_buffer_t *scratch,
+                           const coap_packet_t *inpkt,
+                           coap_packet_t *outpkt,
+                           uint8_t id_hi, uint8_t id_lo);
+
+int resources_get_report(coap_rw_buffer_t *scratch,
+                         const coap_packet_t *inpkt,
+                         coap_packet_t *outpkt,
+                         uint8_t id_hi, uint8_t id_lo);
+
+int resources_put_report(coap_rw_buffer_t *scratch,
+                         const coap_packet_t *inpkt,
+                         coap_packet_t *outpkt,
+                         uint8_t id_hi, uint8_t id_lo);
+
+int resources_get_stats(coap_rw_buffer_t *scratch,
+                        const coap_packet_t *inpkt,
+                        coap_packet_t *outpkt,
+                        uint8_t id_hi, uint8_t id_lo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RESOURCES_H */
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Response arena: the single buffer CoAP responses are serialized in.
+ *
+ * Handlers encode their payload directly at response_payload(), which starts
+ * RESPONSE_HEADROOM bytes into the arena, and hand it to coap_make_response().
+ * The server loop then writes the header, token and options in the headroom
+ * right before the payload, so the payload is not copied between its encoder
+ * and the network stack. Payloads held elsewhere, like constant strings, are
+ * copied into the arena as coap_build() does.
+ */
+
+#ifndef RESPONSE_H
+#define RESPONSE_H
+
+#include <stdint.h>
+#include <coap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESPONSE_HEADROOM       (48)    /* header, token and options */
+
+#ifndef RESPONSE_PAYLOAD_MAX
+#define RESPONSE_PAYLOAD_MAX    (464)
+#endif
+
+/* Payload area of the response being built, RESPONSE_PAYLOAD_MAX bytes long.
+ * Only for handlers running in the server loop, valid until it is sent. */
+uint8_t *response_payload(void);
+
+/* Send nothing back for @p pkt, the response to a NON request that is
+ * answered later in a separate response. */
+void response_none(coap_packet_t *pkt);
+
+/* Serialize @p pkt in the arena and point @p datagram at the result.
+ * Returns its length, 0 if there is nothing to send, or a negative
+ * coap_error_t. */
+int response_build(coap_packet_t *pkt, const uint8_t **datagram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RESPONSE_H */
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Last-sample cache of the sensor resources.
+ *
+ * The sampling job stores each reading it takes, with its sampling time, and
+ * the GET handlers answer from the cache instead of reading the sensor from
+ * the server thread, so a GET costs no bus transaction. Responses carry a
+ * Max-Age equal to the time left until the next run of the sampling job,
+ * when the cached value gets replaced.
+ *
+ * A GET with a "fresh" Uri-Query reads the sensor instead: the read is
+ * queued to the I2C bus worker and a CON request acknowledged right away,
+ * the value following in a separate NON response (5.03 if the read fails),
+ * so the server thread never waits for the bus. A GET arriving before the
+ * first sample, or while too many fresh reads are in progress, is answered
+ * 5.03 with the Max-Age to retry after.
+ */
+
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <coap.h>
+
+#include "scheduler.h"
+#include "telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SAMPLE_CACHE_SIZE
+#define SAMPLE_CACHE_SIZE       (4)     /* metrics cached per firmware */
+#endif
+
+#ifndef SAMPLE_CACHE_FRESH_MAX
+#define SAMPLE_CACHE_FRESH_MAX  (2)     /* fresh reads in progress */
+#endif
+
+#define SAMPLE_CACHE_QUERY      "fresh"
+#define SAMPLE_CACHE_BUF_SIZE   (128)   /* size of a separate response */
+#define SAMPLE_CACHE_TOKEN_MAX_LEN  (8)
+
+/* Read the sensor into @p reading, run by the I2C bus worker. Returns 0 on
+ * success, a negative value if the sensor could not be read. */
+typedef int (*sample_cache_read_t)(telemetry_reading_t *reading);
+
+/* Expire the cached readings with the next run of @p sampling. */
+void sample_cache_init(const scheduler_job_t *sampling);
+
+/* Store @p reading under its name, from the sampling job. */
+void sample_cache_put(const telemetry_reading_t *reading);
+
+/* Answer a GET on metric @p name from the cache like
+ * observe_make_response(), with a Max-Age, or with @p read for a fresh
+ * value. */
+int sample_cache_respond(coap_rw_buffer_t *scratch,
+                         const coap_packet_t *inpkt,
+                         coap_packet_t *outpkt,
+                         uint8_t id_hi, uint8_t id_lo,
+                         const char *name, sample_cache_read_t read);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_CACHE_H */
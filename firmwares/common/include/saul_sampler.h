@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * SAUL sampler: reads a fixed set of SAUL devices through handles looked up
+ * once, instead of walking the SAUL registry on every sample. A failing
+ * read drops the handles, which are looked up again on the next sample.
+ */
+
+#ifndef SAUL_SAMPLER_H
+#define SAUL_SAMPLER_H
+
+#include <stdint.h>
+
+#include "saul_reg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SAUL_SAMPLER_MAX
+#define SAUL_SAMPLER_MAX        (3)     /* devices read by a sampler */
+#endif
+
+typedef struct {
+    const uint8_t *types;               /* SAUL types of the devices */
+    unsigned count;
+    saul_reg_t *devs[SAUL_SAMPLER_MAX]; /* cached handles */
+    int resolved;                       /* whether devs is valid */
+} saul_sampler_t;
+
+/* Prepare @p sampler for the @p count devices of SAUL @p types and look
+ * them up. Returns 0 on success, -EINVAL if @p count is too large or
+ * -ENODEV if a device is missing (it is looked up again on each read). */
+int saul_sampler_init(saul_sampler_t *sampler, const uint8_t *types,
+                      unsigned count);
+
+/* Read every device of @p sampler into @p data, in the order of the types.
+ * Returns 0 on success, -ENODEV if a device is missing or -EIO if a read
+ * failed. */
+int saul_sampler_read(saul_sampler_t *sampler, phydat_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAUL_SAMPLER_H */
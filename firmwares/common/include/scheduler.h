@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Job scheduler: runs the periodic work of a firmware (beacon, sampling,
+ * flushes) from a single thread instead of one sleeping thread per task.
+ *
+ * Jobs are kept in a list ordered by deadline and a single xtimer, armed
+ * with xtimer_set_msg(), wakes the thread up for the earliest one. Periodic
+ * deadlines advance by whole periods from the previous deadline, not from
+ * the time the job ran, so job durations do not make them drift. How late
+ * each run starts after its deadline is recorded per job.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+#include "kernel_types.h"
+#include "telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SCHEDULER_STACKSIZE
+#define SCHEDULER_STACKSIZE     (THREAD_STACKSIZE_DEFAULT)
+#endif
+
+#ifndef SCHEDULER_QUEUE_SIZE
+#define SCHEDULER_QUEUE_SIZE    (8)
+#endif
+
+#define SCHEDULER_STATS_READINGS    (4)
+
+typedef void (*scheduler_cb_t)(void *arg);
+
+typedef struct {
+    uint32_t runs;
+    uint32_t missed;        /* periodic runs skipped after a late one */
+    uint32_t late_max;      /* worst start delay after a deadline (us) */
+    uint64_t late_sum;      /* sum of start delays (us) */
+} scheduler_stats_t;
+
+typedef struct scheduler_job {
+    struct scheduler_job *next;
+    scheduler_cb_t cb;
+    void *arg;
+    uint32_t deadline;      /* next run, in xtimer microseconds */
+    uint32_t period;        /* 0 for a one-shot job */
+    uint32_t due;           /* deadline of the current run */
+    scheduler_stats_t stats;
+} scheduler_job_t;
+
+/* Set the callback run when @p job is posted, without scheduling it. */
+void scheduler_job_init(scheduler_job_t *job, scheduler_cb_t cb, void *arg);
+
+/* Schedule @p job to run @p cb after @p delay microseconds, then every
+ * @p period microseconds unless it is 0. Can be called from any thread. */
+void scheduler_add(scheduler_job_t *job, scheduler_cb_t cb, void *arg,
+                   uint32_t delay, uint32_t period);
+
+/* Cancel @p job if it is scheduled. */
+void scheduler_remove(scheduler_job_t *job);
+
+/* Run the callback of @p job once, as soon as possible, from the scheduler
+ * thread. Never blocks, so it can be used from interrupts and higher
+ * priority threads. Returns 1 on success, 0 if the queue is full. */
+int scheduler_post(scheduler_job_t *job);
+
+/* Fill @p readings with the start delay statistics of @p job, in
+ * microseconds. Returns the number of readings, SCHEDULER_STATS_READINGS. */
+unsigned scheduler_stats_readings(const scheduler_job_t *job,
+                                  telemetry_reading_t *readings);
+
+/* Create the scheduler thread. Returns its pid or a negative errno. */
+kernel_pid_t scheduler_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Runtime statistics: counters and timing histograms of the hot paths.
+ *
+ * The CoAP server loop counts the requests it receives and its parse, build
+ * and send failures, and times each stage of a request: parsing, the
+ * dispatch lookup, the handler, building and sending the reply. Firmwares
+ * time their sensor reads too. Durations are taken from the DWT cycle
+ * counter on Cortex-M3/M4 and from xtimer elsewhere, and kept per stage as
+ * a count, a sum, a maximum and a histogram of power-of-two buckets: bucket
+ * i counts the durations of [2^i, 2^(i+1)) us, the first one also those
+ * below 1 us and the last one everything above.
+ *
+ * They are served as CBOR on /stats:
+ *   { "req": n, "perr": n, "berr": n, "serr": n, "push": n, "pusherr": n,
+ *     "pushdrop": n, "time": { <stage>: [count, mean ns, max ns, first bucket,
+ *                         count of each bucket up to the last non-empty] },
+ *     "stack": { <thread>: [used bytes, size] } }
+ * with stack high-water marks only in DEVELHELP builds, and printed by the
+ * "stats" shell command.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "cpu.h"
+#include "periph_conf.h"
+#else
+#include "xtimer.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATS_BUCKETS           (16)    /* up to 32 ms, and above */
+
+typedef enum {
+    STATS_PARSE,
+    STATS_DISPATCH,
+    STATS_HANDLER,
+    STATS_BUILD,
+    STATS_SEND,
+    STATS_SENSOR,
+    STATS_TIMERS
+} stats_timer_t;
+
+typedef struct {
+    uint32_t requests;      /* datagrams received by the server loop */
+    uint32_t parse_errors;
+    uint32_t build_errors;
+    uint32_t send_errors;   /* replies conn_udp_sendto() failed to send */
+} stats_counters_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;           /* ns */
+    uint64_t sum;           /* ns */
+    uint32_t buckets[STATS_BUCKETS];
+} stats_histogram_t;
+
+/* updated by the server loop only */
+extern stats_counters_t stats_counters;
+
+/* Start the cycle counter, if any. */
+void stats_init(void);
+
+/* Timestamp to pass to stats_record() at the end of the timed stage. */
+static inline uint32_t stats_now(void)
+{
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    return DWT->CYCCNT;
+#else
+    return xtimer_now_usec();
+#endif
+}
+
+/* Record the time elapsed since @p start in the histogram of @p timer,
+ * from any thread. */
+void stats_record(stats_timer_t timer, uint32_t start);
+
+/* Encode the statistics as CBOR in @p buf. Returns the length, or -1 if
+ * they do not fit in @p len bytes. */
+int stats_encode(uint8_t *buf, size_t len);
+
+/* Print the statistics, "stats" shell command. */
+int stats_cmd(int argc, char **argv);
+
+#define STATS_SHELL_COMMAND \
+    { "stats", "print request counters, timings and stack usage", stats_cmd }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_H */
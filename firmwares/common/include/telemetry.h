@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Telemetry sender: pushes CoAP POST requests to the broker.
+ *
+ * The broker address is parsed once by telemetry_init() and every destination
+ * path keeps a pre-encoded CoAP header followed by its Uri-Path option, so a
+ * send only has to patch the message ID and token and append the payload.
+ * Payloads larger than a frame are copied and sent as a Block1 transfer of
+ * CON requests, each block leaving once the broker answered the previous one
+ * with 2.31 Continue, piggybacked or in a separate response (NSTART = 1),
+ * one transfer at a time.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BROKER_ADDR
+#define BROKER_ADDR             "2001:660:3207:102::4"
+#endif
+
+#define BROKER_PORT             (5683)
+
+/* Push confirmable requests, retransmitted until the broker acknowledges
+ * them, instead of non-confirmable ones */
+#ifndef TELEMETRY_CONFIRMABLE
+#define TELEMETRY_CONFIRMABLE   (0)
+#endif
+
+/* ACKs must reach the CoAP server loop, so requests leave its port, Block1
+ * transfers being confirmable in any case */
+#define TELEMETRY_SRC_PORT      (5683)
+
+#ifndef TELEMETRY_BUF_SIZE
+#define TELEMETRY_BUF_SIZE      (128)   /* size of a complete POST request */
+#endif
+
+/*
+ * Largest payload pushed in one POST. A 127-byte 802.15.4 frame loses about
+ * 23 bytes to the MAC header, 34 to compressed IPv6/UDP headers and 14 to
+ * the CoAP header, so bigger payloads would be fragmented by 6LoWPAN.
+ */
+#ifndef TELEMETRY_PAYLOAD_MAX
+#define TELEMETRY_PAYLOAD_MAX   (56)
+#endif
+
+#ifndef TELEMETRY_TRANSFER_MAX
+#define TELEMETRY_TRANSFER_MAX  (320)   /* largest Block1 payload */
+#endif
+
+/* CoAP Content-Formats understood by the encoders */
+#define TELEMETRY_FORMAT_TEXT           (0)     /* text/plain */
+#define TELEMETRY_FORMAT_CBOR           (60)    /* application/cbor */
+#define TELEMETRY_FORMAT_SENML_CBOR     (112)   /* application/senml+cbor */
+
+/* Content-Format of the readings pushed to the broker */
+#ifndef TELEMETRY_FORMAT
+#define TELEMETRY_FORMAT        TELEMETRY_FORMAT_TEXT
+#endif
+
+#ifndef TELEMETRY_BEACON_INTERVAL
+#define TELEMETRY_BEACON_INTERVAL   (30000000U)     /* 30 seconds */
+#endif
+
+#ifndef TELEMETRY_TOKEN_LEN
+#define TELEMETRY_TOKEN_LEN     (2)     /* random token of each request */
+#endif
+
+#define TELEMETRY_PATH_MAX_LEN  (24)    /* longest supported Uri-Path */
+#define TELEMETRY_HDR_MAX_LEN   (4 + TELEMETRY_TOKEN_LEN + 2 + \
+                                 TELEMETRY_PATH_MAX_LEN + 3)
+
+typedef struct {
+    uint8_t hdr[TELEMETRY_HDR_MAX_LEN]; /* header, token, Uri-Path,
+                                           Content-Format */
+    uint8_t hdr_len;
+    uint16_t format;                    /* Content-Format of the payload */
+} telemetry_path_t;
+
+/* scheduler jobs, scheduler.h including this header */
+struct scheduler_job;
+
+/* a single sensor value, kept as a decimal fixed-point number */
+typedef struct {
+    const char *name;       /* metric name, e.g. "temperature" */
+    const char *unit;       /* unit appended in text form, e.g. "hPa" */
+    int32_t value;          /* value in units of 10^scale */
+    int8_t scale;           /* decimal exponent applied to value */
+    uint32_t time;          /* sampling time in xtimer microseconds, 0 if
+                               unknown */
+} telemetry_reading_t;
+
+/* delivery counters of the requests pushed to the broker */
+typedef struct {
+    uint32_t sent;          /* requests handed to conn_udp, resends included */
+    uint32_t send_errors;   /* requests conn_udp failed to send */
+    uint32_t dropped;       /* payloads refused: too large, a transfer in
+                               progress or no in-flight entry for one */
+    uint32_t acked;         /* CON requests acknowledged */
+    uint32_t retransmits;   /* CON requests sent again after a timeout */
+    uint32_t timeouts;      /* CON requests given up after the last resend */
+    uint32_t srtt;          /* smoothed round-trip time (us), 0 if unknown */
+    uint32_t rttvar;        /* round-trip time variation (us) */
+    uint32_t rto;           /* retransmission timeout of new requests (us) */
+} telemetry_stats_t;
+
+extern telemetry_stats_t telemetry_stats;
+
+/* destinations used by every firmware, ready after telemetry_init() */
+extern telemetry_path_t telemetry_server;
+extern telemetry_path_t telemetry_alive;
+
+/* Parse the broker address and prepare the "server" and "alive" paths.
+ * Returns 0 on success, -1 if BROKER_ADDR is not a valid IPv6 address. */
+int telemetry_init(void);
+
+/* Pre-encode the POST header for a single segment @p uri_path carrying
+ * payloads of Content-Format @p format. */
+int telemetry_path_init(telemetry_path_t *path, const char *uri_path,
+                        uint16_t format);
+
+/* Send @p len bytes of @p payload to @p path on the broker, as a Block1
+ * transfer if it does not fit in TELEMETRY_PAYLOAD_MAX. Returns a negative
+ * value on error, -EBUSY if a transfer is in progress, -EAGAIN if no
+ * confirmable request can be kept for it. */
+int telemetry_send(const telemetry_path_t *path,
+                   const uint8_t *payload, size_t len);
+
+/* Whether a Block1 transfer is in progress. */
+int telemetry_transfer_busy(void);
+
+/* Post @p job to the scheduler each time a Block1 transfer ends, to send
+ * what waited for it. */
+void telemetry_transfer_notify(struct scheduler_job *job);
+
+/* Send "Alive" to the "alive" path every TELEMETRY_BEACON_INTERVAL, from
+ * the scheduler thread. */
+void telemetry_beacon_start(void);
+
+/* Encode @p count readings in the format of @p path and send them, split
+ * over several POSTs if they do not fit in TELEMETRY_PAYLOAD_MAX. */
+int telemetry_send_readings(const telemetry_path_t *path,
+                            const telemetry_reading_t *readings,
+                            unsigned count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Telemetry batching: collects the readings of one or more sampling cycles
+ * and pushes them together, in as few CoAP POSTs as the payload size allows.
+ */
+
+#ifndef TELEMETRY_BATCH_H
+#define TELEMETRY_BATCH_H
+
+#include <stdint.h>
+
+#include "telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TELEMETRY_BATCH_MAX
+#define TELEMETRY_BATCH_MAX     (12)    /* readings held before a forced flush */
+#endif
+
+typedef struct {
+    const telemetry_path_t *path;
+    telemetry_reading_t readings[TELEMETRY_BATCH_MAX];
+    unsigned count;
+    unsigned cycles;        /* cycles closed since the oldest reading */
+    unsigned flush_cycles;  /* flush once that many cycles are closed */
+    uint32_t max_delay;     /* flush once the oldest reading is that old (us) */
+    uint32_t first;         /* time at which the oldest reading was queued */
+} telemetry_batch_t;
+
+/* Prepare @p batch to push to @p path every @p flush_cycles sampling
+ * cycles, whatever the number of readings each of them queued. */
+void telemetry_batch_init(telemetry_batch_t *batch,
+                          const telemetry_path_t *path,
+                          unsigned flush_cycles, uint32_t max_delay);
+
+/* Queue a reading, flushing first if the batch is already full. */
+int telemetry_batch_add(telemetry_batch_t *batch,
+                        const telemetry_reading_t *reading);
+
+/* Close a sampling cycle: flush if enough cycles are closed or the deadline
+ * is reached. */
+int telemetry_batch_commit(telemetry_batch_t *batch);
+
+/* Push every queued reading now. */
+int telemetry_batch_flush(telemetry_batch_t *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_BATCH_H */
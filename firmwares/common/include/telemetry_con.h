@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Confirmable telemetry: retransmission of CON requests until acknowledged.
+ *
+ * Each CON request pushed to the broker is copied in a small in-flight table
+ * until the ACK (or RST) carrying its message ID comes back to the CoAP server
+ * loop. A request whose outcome is awaited and that gets an empty ACK stays
+ * in the table until the separate response carrying its token arrives, or
+ * TELEMETRY_RESPONSE_TIMEOUT later. Unacknowledged requests are resent from
+ * the scheduler thread with the
+ * exponential backoff of RFC 7252, section 4.2, and dropped after
+ * TELEMETRY_MAX_RETRANSMIT attempts. The initial timeout is not the fixed
+ * ACK_TIMEOUT but a retransmission timeout estimated from the round-trip times
+ * of the requests acknowledged at their first attempt, as in RFC 6298.
+ */
+
+#ifndef TELEMETRY_CON_H
+#define TELEMETRY_CON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TELEMETRY_CON_MAX
+#define TELEMETRY_CON_MAX       (4)     /* requests awaiting an ACK */
+#endif
+
+#define TELEMETRY_ACK_TIMEOUT       (2000000U)  /* RTO before any sample */
+#define TELEMETRY_RTO_MIN           (1000000U)
+#define TELEMETRY_RTO_MAX           (30000000U)
+#define TELEMETRY_MAX_RETRANSMIT    (4)
+
+#ifndef TELEMETRY_RESPONSE_TIMEOUT
+#define TELEMETRY_RESPONSE_TIMEOUT  (30000000U) /* separate response wait */
+#endif
+
+/* Reset the retransmission timeout and empty the in-flight table. */
+void telemetry_con_init(void);
+
+/* Send the request @p pkt of @p len bytes to the broker and count it in
+ * telemetry_stats. Returns the result of conn_udp_sendto(). */
+int telemetry_sendto(const uint8_t *pkt, size_t len);
+
+/* Outcome of a CON request: @p res is 0 once answered, @p rsp being the
+ * piggybacked or separate response, -ECONNRESET if the broker rejected it
+ * or -ETIMEDOUT after the last resend or the response wait (@p rsp NULL). */
+typedef void (*telemetry_con_cb_t)(void *arg, int res,
+                                   const coap_packet_t *rsp);
+
+/* Keep an entry of the table for the requests of a Block1 transfer, until
+ * telemetry_con_release(), so that no block finds the table full. Returns 0
+ * on success, -EAGAIN if no entry is free. */
+int telemetry_con_reserve(void);
+
+/* Give the reserved entry back, once the transfer ended. */
+void telemetry_con_release(void);
+
+/* Send the CON request @p pkt of @p len bytes and keep a copy until it is
+ * acknowledged, then run @p cb (NULL for none) with @p arg from the thread
+ * that saw the outcome. A request with @p cb is a block of a transfer and
+ * uses the reserved entry. When the table is full a request without @p cb
+ * is sent non-confirmable instead. Returns the result of conn_udp_sendto();
+ * for a request with @p cb, 0 once kept (the resends cover a failed send) or
+ * -EAGAIN if the reserved entry is missing or busy. */
+int telemetry_con_send(uint8_t *pkt, size_t len, telemetry_con_cb_t cb,
+                       void *arg);
+
+/* Match the ACK or RST @p pkt with the request it answers by message ID,
+ * or the separate response @p pkt with the request awaiting it by token.
+ * Returns 1 if it answered a request in flight, 0 otherwise. */
+int telemetry_con_ack(const coap_packet_t *pkt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_CON_H */
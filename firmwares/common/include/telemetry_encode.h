@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Encoders turning telemetry readings into CoAP payloads:
+ * - text/plain: "name:value unit", one reading per line;
+ * - application/cbor: an array of [name, value, time] records, one per
+ *   reading, as a batch can hold several readings of a metric;
+ * - application/senml+cbor: a SenML pack with one record per reading.
+ * Values with a decimal scale are CBOR decimal fractions (tag 4), so no
+ * floating point is involved. Timestamped readings carry their time
+ * relative to the encoding time, in seconds, and a time of 0 otherwise.
+ */
+
+#ifndef TELEMETRY_ENCODE_H
+#define TELEMETRY_ENCODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <coap.h>
+
+#include "telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COAP_RSPCODE_NOT_ACCEPTABLE     MAKE_RSPCODE(4, 6)
+#define COAP_RSPCODE_INTERNAL_ERROR     MAKE_RSPCODE(5, 0)
+
+/* Whether the encoders support Content-Format @p format. */
+bool telemetry_format_supported(uint16_t format);
+
+/* Encode @p count readings as @p format into @p buf.
+ * Returns the payload length or -1 if it does not fit. */
+int telemetry_encode(uint16_t format, const telemetry_reading_t *readings,
+                     unsigned count, uint8_t *buf, size_t len);
+
+/* Encode the payload of a response to a GET: like telemetry_encode() but a
+ * single reading in text/plain is its bare value. */
+int telemetry_encode_response(uint16_t format,
+                              const telemetry_reading_t *readings,
+                              unsigned count, uint8_t *buf, size_t len);
+
+/* Format the value and unit of @p reading, e.g. "21.53°C", NUL-terminated.
+ * Returns the string length or -1 if it does not fit. */
+int telemetry_value_fmt(char *buf, size_t len,
+                        const telemetry_reading_t *reading);
+
+/* Content-Format asked for by the Accept option of @p pkt, text/plain if
+ * there is none. */
+uint16_t telemetry_accept_format(const coap_packet_t *pkt);
+
+/* Answer a GET with @p count readings in the format asked for by @p inpkt,
+ * encoded in the response arena. A single reading in text/plain is sent as
+ * its bare value, unsupported formats get 4.06. */
+int telemetry_make_response(coap_rw_buffer_t *scratch,
+                            const coap_packet_t *inpkt,
+                            coap_packet_t *outpkt,
+                            uint8_t id_hi, uint8_t id_lo,
+                            const telemetry_reading_t *readings,
+                            unsigned count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_ENCODE_H */
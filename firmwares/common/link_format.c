@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <coap.h>
+
+#include "link_format.h"
+
+static char document[LINK_FORMAT_MAX_LEN];
+static size_t document_len = 0;
+
+/* append @p len bytes of @p s at @p pos, returns the new position or NULL
+ * if they do not fit */
+static char *_append(char *pos, const char *end, const char *s, size_t len)
+{
+    if ((pos == NULL) || ((size_t)(end - pos) < len)) {
+        return NULL;
+    }
+    memcpy(pos, s, len);
+    return pos + len;
+}
+
+size_t link_format_build(const coap_endpoint_t *endpoints,
+                         char *buf, size_t len)
+{
+    const char *end = buf + len;
+    const coap_endpoint_path_t *last = NULL;
+    char *doc_end = buf;
+
+    for (const coap_endpoint_t *ep = endpoints; ep->handler != NULL; ep++) {
+        /* a path served by several methods is listed once */
+        if ((ep->core_attr == NULL) || (ep->path == last)) {
+            continue;
+        }
+        last = ep->path;
+
+        char *pos = doc_end;
+        if (pos != buf) {
+            pos = _append(pos, end, ",", 1);
+        }
+        pos = _append(pos, end, "<", 1);
+        for (int i = 0; i < ep->path->count; i++) {
+            pos = _append(pos, end, "/", 1);
+            pos = _append(pos, end, ep->path->elems[i],
+                          strlen(ep->path->elems[i]));
+        }
+        pos = _append(pos, end, ">;", 2);
+        pos = _append(pos, end, ep->core_attr, strlen(ep->core_attr));
+
+        if (pos == NULL) {
+            printf("Error: link format document truncated at %u bytes, "
+                   "raise LINK_FORMAT_MAX_LEN\n", (unsigned)(doc_end - buf));
+            break;
+        }
+        doc_end = pos;
+    }
+
+    return doc_end - buf;
+}
+
+int link_format_response(coap_rw_buffer_t *scratch,
+                         const coap_packet_t *inpkt,
+                         coap_packet_t *outpkt,
+                         uint8_t id_hi, uint8_t id_lo,
+                         const coap_endpoint_t *endpoints)
+{
+    if (document_len == 0) {
+        document_len = link_format_build(endpoints, document,
+                                         sizeof(document));
+    }
+
+    return coap_make_response(scratch, outpkt, (const uint8_t *)document,
+                              document_len, id_hi, id_lo, &inpkt->tok,
+                              COAP_RSPCODE_CONTENT,
+                              COAP_CONTENTTYPE_APPLICATION_LINKFORMAT);
+}
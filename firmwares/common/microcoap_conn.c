@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <string.h>
+
+#include "net/af.h"
+#include "net/conn/udp.h"
+
+#ifdef MICROCOAP_DEBUG
+#define ENABLE_DEBUG (1)
+#else
+#define ENABLE_DEBUG (0)
+#endif
+#include "debug.h"
+
+#include "coap.h"
+#include "block.h"
+#include "dispatch.h"
+#include "observe.h"
+#include "response.h"
+#include "stats.h"
+#include "telemetry_con.h"
+#include "microcoap_conn.h"
+
+static uint8_t _udp_buf[512];   /* udp read buffer (max udp payload size) */
+uint8_t scratch_raw[1024];      /* microcoap scratch buffer */
+
+coap_rw_buffer_t scratch_buf = { scratch_raw, sizeof(scratch_raw) };
+
+#define COAP_SERVER_PORT    (5683)
+
+/* sender of the request being handled */
+static uint8_t raddr[16] = { 0 };
+static size_t raddr_len;
+static uint16_t rport;
+
+void microcoap_remote(uint8_t *addr, size_t *addr_len, uint16_t *port)
+{
+    memcpy(addr, raddr, sizeof(raddr));
+    *addr_len = raddr_len;
+    *port = rport;
+}
+
+/* acknowledge the confirmable message @p pkt with an empty ACK */
+static void _send_empty_ack(const coap_packet_t *pkt)
+{
+    uint8_t ack[4] = {
+        (1 << 6) | (COAP_TYPE_ACK << 4), 0, pkt->hdr.id[0], pkt->hdr.id[1]
+    };
+
+    if (conn_udp_sendto(ack, sizeof(ack), NULL, 0, raddr, raddr_len,
+                        AF_INET6, COAP_SERVER_PORT, rport) < 0) {
+        stats_counters.send_errors++;
+    }
+}
+
+void microcoap_server_loop(void)
+{
+    uint8_t laddr[16] = { 0 };
+
+    conn_udp_t conn;
+
+    int rc = conn_udp_create(&conn, laddr, sizeof(laddr), AF_INET6, COAP_SERVER_PORT);
+
+    /* index the endpoints by path once, instead of scanning them for every
+       request */
+    dispatch_init();
+    stats_init();
+
+    while (1) {
+        DEBUG("Waiting for incoming UDP packet...\n");
+        rc = conn_udp_recvfrom(&conn, (char *)_udp_buf, sizeof(_udp_buf), raddr, &raddr_len, &rport);
+        if (rc < 0) {
+            DEBUG("Error in conn_udp_recvfrom(). rc=%u\n", rc);
+            continue;
+        }
+
+        size_t n = rc;
+        stats_counters.requests++;
+
+        /* let observe registrations know who is asking */
+        observe_set_remote(raddr, raddr_len, rport);
+
+        coap_packet_t pkt;
+        DEBUG("Received packet: ");
+        coap_dump(_udp_buf, n, true);
+        DEBUG("\n");
+
+        /* parse UDP packet to CoAP */
+        uint32_t start = stats_now();
+        rc = coap_parse(&pkt, _udp_buf, n);
+        stats_record(STATS_PARSE, start);
+        if (0 != rc) {
+            DEBUG("Bad packet rc=%d\n", rc);
+            stats_counters.parse_errors++;
+        }
+        else if (pkt.hdr.t == COAP_TYPE_ACK) {
+            /* the broker acknowledged a confirmable push, or an observer a
+               confirmable notification */
+            telemetry_con_ack(&pkt);
+            observe_ack(&pkt);
+        }
+        else if (pkt.hdr.t == COAP_TYPE_RESET) {
+            /* a client rejected a notification: stop observing, or the
+               broker rejected a confirmable push: stop resending it */
+            observe_reset(&pkt);
+            telemetry_con_ack(&pkt);
+        }
+        else if ((pkt.hdr.code >> 5) != 0) {
+            /* a separate response to a pushed request, acknowledged even if
+               no request awaits it any more (RFC 7252, section 5.2.2) */
+            if (pkt.hdr.t == COAP_TYPE_CON) {
+                _send_empty_ack(&pkt);
+            }
+            telemetry_con_ack(&pkt);
+        }
+        else {
+            coap_packet_t rsppkt;
+            DEBUG("content:\n");
+            coap_dumpPacket(&pkt);
+
+            /* reassemble Block1 requests before handling them */
+            if (block1_receive(&scratch_buf, &pkt, &rsppkt) == 0) {
+                /* handle CoAP request */
+                dispatch_request(&scratch_buf, &pkt, &rsppkt);
+                /* serve large responses in Block2 slices */
+                block_apply(&pkt, &rsppkt);
+            }
+
+            /* build reply, around the payload left in the response arena */
+            const uint8_t *rsp;
+            start = stats_now();
+            rc = response_build(&rsppkt, &rsp);
+            stats_record(STATS_BUILD, start);
+            if (rc < 0) {
+                DEBUG("coap_build failed rc=%d\n", -rc);
+                stats_counters.build_errors++;
+            }
+            else if (rc > 0) {
+                size_t rsplen = rc;
+                DEBUG("Sending packet: ");
+                coap_dump(rsp, rsplen, true);
+                DEBUG("\n");
+                DEBUG("content:\n");
+                coap_dumpPacket(&rsppkt);
+
+                /* send reply via UDP */
+                start = stats_now();
+                rc = conn_udp_sendto(rsp, rsplen, NULL, 0, raddr, raddr_len, AF_INET6, COAP_SERVER_PORT, rport);
+                stats_record(STATS_SEND, start);
+                if (rc < 0) {
+                    DEBUG("Error sending CoAP reply via udp; %u\n", rc);
+                    stats_counters.send_errors++;
+                }
+            }
+        }
+    }
+}
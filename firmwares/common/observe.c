@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <coap.h>
+
+#include "mutex.h"
+#include "net/af.h"
+#include "net/conn/udp.h"
+#include "xtimer.h"
+
+#include "coap_id.h"
+#include "coap_msg.h"
+#include "observe.h"
+#include "scheduler.h"
+#include "telemetry_encode.h"
+
+#define COAP_PAYLOAD_MARKER     (0xff)
+#define OBSERVE_REGISTER        (0)
+#define OBSERVE_SEQ_MASK        (0xffffff)  /* sequence numbers are 24-bit */
+#define US_PER_S                (1000000U)
+
+typedef struct {
+    const char *resource;       /* observed resource, NULL if the slot is free */
+    uint8_t addr[16];
+    uint16_t port;
+    uint8_t token[OBSERVE_TOKEN_MAX_LEN];
+    uint8_t tkl;
+    uint16_t format;            /* Content-Format asked for at registration */
+    uint16_t msg_id;            /* ID of the last notification, for RST */
+    int32_t threshold;          /* minimum change triggering a notification */
+    int32_t last[OBSERVE_VALUES_MAX];   /* values last sent to the observer */
+    uint32_t con_due;           /* uptime (s) at which a CON one is due */
+} observer_t;
+
+static observer_t observers[OBSERVE_MAX_OBSERVERS];
+static mutex_t observers_lock = MUTEX_INIT;
+
+static uint32_t seq = 0;
+static uint8_t notify_buf[OBSERVE_BUF_SIZE];
+
+/* CON notification in flight, kept for its resends */
+static observer_t *con_obs = NULL;
+static uint16_t con_id;
+static uint16_t con_len;
+static uint8_t con_retransmits;
+static uint32_t con_timeout;
+static uint8_t con_buf[OBSERVE_BUF_SIZE];
+static scheduler_job_t con_job;
+
+/* sender of the request being handled, set by the server loop */
+static uint8_t remote_addr[16];
+static uint16_t remote_port;
+
+/* threshold asked for with a "th=<n>" Uri-Query, 0 if there is none */
+static int32_t _get_threshold(const coap_packet_t *pkt)
+{
+    uint8_t count;
+    const coap_option_t *opt = coap_findOptions(pkt, COAP_OPTION_URI_QUERY,
+                                                &count);
+
+    for (unsigned i = 0; (opt != NULL) && (i < count); i++) {
+        const uint8_t *query = opt[i].buf.p;
+        size_t len = opt[i].buf.len;
+        int32_t threshold = 0;
+
+        if ((len <= 3) || (memcmp(query, "th=", 3) != 0)) {
+            continue;
+        }
+        for (size_t c = 3; c < len; c++) {
+            if ((query[c] < '0') || (query[c] > '9')) {
+                return 0;
+            }
+            threshold = threshold * 10 + (query[c] - '0');
+        }
+        return threshold;
+    }
+    return 0;
+}
+
+static uint32_t _uptime(void)
+{
+    return xtimer_now_usec64() / US_PER_S;
+}
+
+/* free the slot of @p obs, to be called locked */
+static void _remove(observer_t *obs)
+{
+    obs->resource = NULL;
+    if (obs == con_obs) {
+        con_obs = NULL;
+        scheduler_remove(&con_job);
+    }
+}
+
+static observer_t *_find(const char *resource)
+{
+    for (unsigned i = 0; i < OBSERVE_MAX_OBSERVERS; i++) {
+        observer_t *obs = &observers[i];
+        if ((obs->resource != NULL) &&
+            (strcmp(obs->resource, resource) == 0) &&
+            (obs->port == remote_port) &&
+            (memcmp(obs->addr, remote_addr, sizeof(remote_addr)) == 0)) {
+            return obs;
+        }
+    }
+    return NULL;
+}
+
+static observer_t *_find_free(void)
+{
+    for (unsigned i = 0; i < OBSERVE_MAX_OBSERVERS; i++) {
+        if (observers[i].resource == NULL) {
+            return &observers[i];
+        }
+    }
+    return NULL;
+}
+
+static void _save_values(observer_t *obs, const telemetry_reading_t *readings,
+                         unsigned count)
+{
+    for (unsigned i = 0; (i < count) && (i < OBSERVE_VALUES_MAX); i++) {
+        obs->last[i] = readings[i].value;
+    }
+}
+
+/* whether a value moved by at least the threshold of @p obs */
+static int _changed(const observer_t *obs, const telemetry_reading_t *readings,
+                    unsigned count)
+{
+    for (unsigned i = 0; (i < count) && (i < OBSERVE_VALUES_MAX); i++) {
+        int32_t delta = readings[i].value - obs->last[i];
+        if (delta < 0) {
+            delta = -delta;
+        }
+        if ((delta > 0) && (delta >= obs->threshold)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int _sendto(const observer_t *obs, const uint8_t *buf, size_t len)
+{
+    return conn_udp_sendto(buf, len, NULL, 0, obs->addr, sizeof(obs->addr),
+                           AF_INET6, OBSERVE_SRC_PORT, obs->port);
+}
+
+/* scheduler job, resends the CON notification or gives up on its observer */
+static void _con_resend(void *arg)
+{
+    (void)arg;
+
+    mutex_lock(&observers_lock);
+    if (con_obs != NULL) {
+        if (con_retransmits == OBSERVE_MAX_RETRANSMIT) {
+            /* the observer is gone */
+            _remove(con_obs);
+        }
+        else {
+            con_retransmits++;
+            con_timeout *= 2;
+            _sendto(con_obs, con_buf, con_len);
+            scheduler_add(&con_job, _con_resend, NULL, con_timeout, 0);
+        }
+    }
+    mutex_unlock(&observers_lock);
+}
+
+static int _send_notification(observer_t *obs,
+                              const telemetry_reading_t *readings,
+                              unsigned count, int confirmable)
+{
+    uint8_t *buf = confirmable ? con_buf : notify_buf;
+    uint8_t *p = buf;
+    unsigned seq_len = coap_msg_uint_len(seq);
+    unsigned format_len = coap_msg_uint_len(obs->format);
+
+    obs->msg_id = coap_id_next();
+
+    *p++ = (1 << 6) |
+           ((confirmable ? COAP_TYPE_CON : COAP_TYPE_NONCON) << 4) | obs->tkl;
+    *p++ = COAP_RSPCODE_CONTENT;
+    *p++ = obs->msg_id >> 8;
+    *p++ = obs->msg_id & 0xff;
+    memcpy(p, obs->token, obs->tkl);
+    p += obs->tkl;
+
+    /* Observe then Content-Format, both deltas fit in the option nibble */
+    *p++ = (COAP_OPTION_OBSERVE << 4) | seq_len;
+    p = coap_msg_put_uint(p, seq, seq_len);
+    *p++ = ((COAP_OPTION_CONTENT_FORMAT - COAP_OPTION_OBSERVE) << 4) |
+           format_len;
+    p = coap_msg_put_uint(p, obs->format, format_len);
+    *p++ = COAP_PAYLOAD_MARKER;
+
+    int res = telemetry_encode_response(obs->format, readings, count, p,
+                                        OBSERVE_BUF_SIZE - (p - buf));
+    if (res < 0) {
+        puts("Error: observe notification too large");
+        return -ENOMEM;
+    }
+
+    size_t len = (p - buf) + res;
+    if (confirmable) {
+        /* the first timeout is drawn from [ACK_TIMEOUT, 1.5 * ACK_TIMEOUT] */
+        con_obs = obs;
+        con_id = obs->msg_id;
+        con_len = len;
+        con_retransmits = 0;
+        con_timeout = OBSERVE_ACK_TIMEOUT +
+                      coap_id_random() % (OBSERVE_ACK_TIMEOUT / 2 + 1);
+        scheduler_add(&con_job, _con_resend, NULL, con_timeout, 0);
+    }
+    return _sendto(obs, buf, len);
+}
+
+void observe_set_remote(const uint8_t *addr, size_t addr_len, uint16_t port)
+{
+    if (addr_len > sizeof(remote_addr)) {
+        addr_len = sizeof(remote_addr);
+    }
+    memset(remote_addr, 0, sizeof(remote_addr));
+    memcpy(remote_addr, addr, addr_len);
+    remote_port = port;
+}
+
+void observe_reset(const coap_packet_t *pkt)
+{
+    uint16_t id = (pkt->hdr.id[0] << 8) | pkt->hdr.id[1];
+
+    mutex_lock(&observers_lock);
+    for (unsigned i = 0; i < OBSERVE_MAX_OBSERVERS; i++) {
+        observer_t *obs = &observers[i];
+        if ((obs->resource != NULL) &&
+            ((obs->msg_id == id) || ((obs == con_obs) && (con_id == id))) &&
+            (obs->port == remote_port) &&
+            (memcmp(obs->addr, remote_addr, sizeof(remote_addr)) == 0)) {
+            _remove(obs);
+        }
+    }
+    mutex_unlock(&observers_lock);
+}
+
+void observe_ack(const coap_packet_t *pkt)
+{
+    uint16_t id = (pkt->hdr.id[0] << 8) | pkt->hdr.id[1];
+
+    mutex_lock(&observers_lock);
+    if ((con_obs != NULL) && (con_id == id) &&
+        (con_obs->port == remote_port) &&
+        (memcmp(con_obs->addr, remote_addr, sizeof(remote_addr)) == 0)) {
+        /* still interested, the next CON one is due in a day */
+        con_obs->con_due = _uptime() + OBSERVE_CON_INTERVAL;
+        con_obs = NULL;
+        scheduler_remove(&con_job);
+    }
+    mutex_unlock(&observers_lock);
+}
+
+int observe_make_response(coap_rw_buffer_t *scratch,
+                          const coap_packet_t *inpkt,
+                          coap_packet_t *outpkt,
+                          uint8_t id_hi, uint8_t id_lo,
+                          const char *resource,
+                          const telemetry_reading_t *readings,
+                          unsigned count)
+{
+    int res = telemetry_make_response(scratch, inpkt, outpkt, id_hi, id_lo,
+                                      readings, count);
+    if ((res != 0) || (outpkt->hdr.code != COAP_RSPCODE_CONTENT)) {
+        return res;
+    }
+
+    uint8_t opt_count;
+    const coap_option_t *opt = coap_findOptions(inpkt, COAP_OPTION_OBSERVE,
+                                                &opt_count);
+
+    mutex_lock(&observers_lock);
+    observer_t *obs = _find(resource);
+
+    if ((opt == NULL) || (coap_msg_get_uint(opt) != OBSERVE_REGISTER)) {
+        /* deregistration, or a plain GET for the same observation */
+        if ((obs != NULL) && (obs->tkl == inpkt->tok.len) &&
+            (memcmp(obs->token, inpkt->tok.p, obs->tkl) == 0)) {
+            _remove(obs);
+        }
+        mutex_unlock(&observers_lock);
+        return res;
+    }
+
+    if (obs == NULL) {
+        obs = _find_free();
+    }
+    else if (obs == con_obs) {
+        /* registered again, which answers the CON notification */
+        con_obs = NULL;
+        scheduler_remove(&con_job);
+    }
+    /* a full table or a too long token is answered as a plain GET */
+    if ((obs == NULL) || (inpkt->tok.len > OBSERVE_TOKEN_MAX_LEN) ||
+        (scratch->len < 2 + 3)) {
+        mutex_unlock(&observers_lock);
+        return res;
+    }
+
+    obs->resource = resource;
+    memcpy(obs->addr, remote_addr, sizeof(remote_addr));
+    obs->port = remote_port;
+    memcpy(obs->token, inpkt->tok.p, inpkt->tok.len);
+    obs->tkl = inpkt->tok.len;
+    obs->format = telemetry_accept_format(inpkt);
+    obs->threshold = _get_threshold(inpkt);
+    obs->con_due = _uptime() + OBSERVE_CON_INTERVAL;
+    _save_values(obs, readings, count);
+
+    /* coap_make_response() keeps the Content-Format value in the first two
+     * scratch bytes, the Observe value goes right after */
+    unsigned seq_len = coap_msg_uint_len(seq);
+    coap_msg_put_uint(scratch->p + 2, seq, seq_len);
+    coap_msg_add_option(outpkt, COAP_OPTION_OBSERVE, scratch->p + 2, seq_len);
+
+    mutex_unlock(&observers_lock);
+    return res;
+}
+
+void observe_notify(const char *resource,
+                    const telemetry_reading_t *readings, unsigned count)
+{
+    int sequence_used = 0;
+    uint32_t now = _uptime();
+
+    mutex_lock(&observers_lock);
+    for (unsigned i = 0; i < OBSERVE_MAX_OBSERVERS; i++) {
+        observer_t *obs = &observers[i];
+        if ((obs->resource == NULL) ||
+            (strcmp(obs->resource, resource) != 0)) {
+            continue;
+        }
+        /* a due CON notification is sent even without a change */
+        int confirmable = (con_obs == NULL) &&
+                          ((int32_t)(now - obs->con_due) >= 0);
+        if (!confirmable && !_changed(obs, readings, count)) {
+            continue;
+        }
+        if (!sequence_used) {
+            seq = (seq + 1) & OBSERVE_SEQ_MASK;
+            sequence_used = 1;
+        }
+        if (_send_notification(obs, readings, count, confirmable) >= 0) {
+            _save_values(obs, readings, count);
+        }
+    }
+    mutex_unlock(&observers_lock);
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "xtimer.h"
+
+#include "report.h"
+
+#define US_PER_S                (1000000U)
+
+void report_init(report_t *report, report_metric_t *metrics, unsigned count)
+{
+    report->metrics = metrics;
+    report->count = count;
+    report->min_interval = REPORT_MIN_INTERVAL;
+    report->max_interval = REPORT_MAX_INTERVAL;
+    mutex_init(&report->lock);
+}
+
+static report_metric_t *_find(report_t *report, const char *name, size_t len)
+{
+    for (unsigned i = 0; i < report->count; i++) {
+        report_metric_t *metric = &report->metrics[i];
+        if ((strncmp(metric->name, name, len) == 0) &&
+            (metric->name[len] == '\0')) {
+            return metric;
+        }
+    }
+    return NULL;
+}
+
+/* whether @p value left the deadband around the last report of @p metric */
+static int _outside_deadband(const report_metric_t *metric, int32_t value)
+{
+    int64_t delta = (int64_t)value - metric->last;
+    int64_t last = metric->last;
+    int64_t band = metric->abs;
+
+    if (delta < 0) {
+        delta = -delta;
+    }
+    if (last < 0) {
+        last = -last;
+    }
+    if (last * metric->permille / 1000 > band) {
+        band = last * metric->permille / 1000;
+    }
+    return delta > band;
+}
+
+int report_changed(report_t *report, const telemetry_reading_t *reading)
+{
+    report_metric_t *metric = _find(report, reading->name,
+                                    strlen(reading->name));
+    uint32_t now = (reading->time != 0) ? reading->time : xtimer_now_usec();
+    int res;
+
+    if (metric == NULL) {
+        return 1;
+    }
+
+    mutex_lock(&report->lock);
+    if (!metric->reported) {
+        res = 1;
+    }
+    else {
+        uint32_t elapsed = now - metric->last_time;
+        if (elapsed < report->min_interval) {
+            res = 0;
+        }
+        else if ((report->max_interval > 0) &&
+                 (elapsed >= report->max_interval)) {
+            res = 1;
+        }
+        else {
+            res = _outside_deadband(metric, reading->value);
+        }
+    }
+    if (res) {
+        metric->reported = 1;
+        metric->last = reading->value;
+        metric->last_time = now;
+    }
+    mutex_unlock(&report->lock);
+
+    return res;
+}
+
+int report_config_print(report_t *report, char *buf, size_t len)
+{
+    size_t p = 0;
+    int n;
+
+    mutex_lock(&report->lock);
+    n = snprintf(buf, len, "min=%lu max=%lu",
+                 (unsigned long)(report->min_interval / US_PER_S),
+                 (unsigned long)(report->max_interval / US_PER_S));
+    for (unsigned i = 0; (i < report->count) && (n >= 0) && (p + n < len);
+         i++) {
+        const report_metric_t *metric = &report->metrics[i];
+        p += n;
+        if (metric->permille > 0) {
+            n = snprintf(&buf[p], len - p, " %s=%ld %s%%=%u.%u",
+                         metric->name, (long)metric->abs, metric->name,
+                         metric->permille / 10, metric->permille % 10);
+        }
+        else {
+            n = snprintf(&buf[p], len - p, " %s=%ld",
+                         metric->name, (long)metric->abs);
+        }
+    }
+    mutex_unlock(&report->lock);
+
+    if ((n < 0) || (p + n >= len)) {
+        return -1;
+    }
+    return p + n;
+}
+
+static int _is_separator(char c)
+{
+    return (c == ' ') || (c == ',') || (c == '&') || (c == '\n');
+}
+
+/* parse a decimal number with at most @p decimals digits after the point,
+ * scaled by 10^decimals */
+static int _parse_fixed(const char *s, size_t len, unsigned decimals,
+                        uint32_t *out)
+{
+    uint64_t value = 0;
+    unsigned digits = 0;
+    int point = 0;
+
+    if (len == 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if ((s[i] == '.') && !point && (decimals > 0)) {
+            point = 1;
+            continue;
+        }
+        if ((s[i] < '0') || (s[i] > '9') || (point && (digits == decimals))) {
+            return -1;
+        }
+        value = value * 10 + (s[i] - '0');
+        digits += point;
+        if (value > UINT32_MAX) {
+            return -1;
+        }
+    }
+    for (; digits < decimals; digits++) {
+        value *= 10;
+    }
+    if (value > UINT32_MAX) {
+        return -1;
+    }
+    *out = value;
+    return 0;
+}
+
+/* check the configuration in @p buf, and apply it if @p apply is set */
+static int _parse(report_t *report, const char *buf, size_t len, int apply)
+{
+    const char *end = buf + len;
+
+    while (buf < end) {
+        if (_is_separator(*buf)) {
+            buf++;
+            continue;
+        }
+
+        const char *key = buf;
+        while ((buf < end) && !_is_separator(*buf)) {
+            buf++;
+        }
+        const char *eq = memchr(key, '=', buf - key);
+        if (eq == NULL) {
+            return -1;
+        }
+
+        size_t key_len = eq - key;
+        int percent = (key_len > 0) && (key[key_len - 1] == '%');
+        uint32_t value;
+        if (percent) {
+            key_len--;
+        }
+        if (_parse_fixed(eq + 1, buf - (eq + 1), percent, &value) < 0) {
+            return -1;
+        }
+
+        if (!percent && (key_len == 3) &&
+            ((memcmp(key, "min", 3) == 0) || (memcmp(key, "max", 3) == 0))) {
+            if (value > UINT32_MAX / US_PER_S) {
+                return -1;
+            }
+            if (apply && (key[1] == 'i')) {
+                report->min_interval = value * US_PER_S;
+            }
+            else if (apply) {
+                report->max_interval = value * US_PER_S;
+            }
+            continue;
+        }
+
+        report_metric_t *metric = _find(report, key, key_len);
+        if ((metric == NULL) || (value > (percent ? UINT16_MAX : INT32_MAX))) {
+            return -1;
+        }
+        if (apply && percent) {
+            metric->permille = value;
+        }
+        else if (apply) {
+            metric->abs = value;
+        }
+    }
+    return 0;
+}
+
+int report_config_parse(report_t *report, const char *buf, size_t len)
+{
+    if (_parse(report, buf, len, 0) < 0) {
+        return -1;
+    }
+    mutex_lock(&report->lock);
+    _parse(report, buf, len, 1);
+    mutex_unlock(&report->lock);
+    return 0;
+}
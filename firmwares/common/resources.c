@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <string.h>
+#include <coap.h>
+
+#include "board.h"
+#include "irq.h"
+#include "periph/gpio.h"
+#ifdef MODULE_IOTKIT_SIM
+#include "sim.h"
+#endif
+
+#include "link_format.h"
+#include "telemetry.h"
+#include "telemetry_encode.h"
+#include "resources.h"
+#include "response.h"
+#include "stats.h"
+
+const coap_endpoint_path_t resources_path_well_known_core =
+        { 2, { ".well-known", "core" } };
+const coap_endpoint_path_t resources_path_name = { 1, { "name" } };
+const coap_endpoint_path_t resources_path_os = { 1, { "os" } };
+const coap_endpoint_path_t resources_path_board = { 1, { "board" } };
+const coap_endpoint_path_t resources_path_mcu = { 1, { "mcu" } };
+const coap_endpoint_path_t resources_path_led = { 1, { "led" } };
+const coap_endpoint_path_t resources_path_sampling = { 1, { "sampling" } };
+const coap_endpoint_path_t resources_path_report = { 1, { "report" } };
+const coap_endpoint_path_t resources_path_stats = { 1, { "stats" } };
+
+static const char *app_name = "";
+static const scheduler_job_t *sampling_job = NULL;
+static report_t *report = NULL;
+static scheduler_job_t led_job;
+static int led_pending = 0;
+
+void resources_init(const char *name, const scheduler_job_t *sampling,
+                    report_t *report_settings)
+{
+    app_name = name;
+    sampling_job = sampling;
+    report = report_settings;
+}
+
+/* answer with a constant string, referenced until the response is sent */
+static int _text_response(coap_rw_buffer_t *scratch,
+                          const coap_packet_t *inpkt, coap_packet_t *outpkt,
+                          uint8_t id_hi, uint8_t id_lo, const char *text)
+{
+    return coap_make_response(scratch, outpkt, (const uint8_t *)text,
+                              strlen(text), id_hi, id_lo, &inpkt->tok,
+                              COAP_RSPCODE_CONTENT,
+                              COAP_CONTENTTYPE_TEXT_PLAIN);
+}
+
+int resources_get_well_known_core(coap_rw_buffer_t *scratch,
+                                  const coap_packet_t *inpkt,
+                                  coap_packet_t *outpkt,
+                                  uint8_t id_hi, uint8_t id_lo)
+{
+    return link_format_response(scratch, inpkt, outpkt, id_hi, id_lo,
+                                endpoints);
+}
+
+int resources_get_name(coap_rw_buffer_t *scratch,
+                       const coap_packet_t *inpkt,
+                       coap_packet_t *outpkt,
+                       uint8_t id_hi, uint8_t id_lo)
+{
+    return _text_response(scratch, inpkt, outpkt, id_hi, id_lo, app_name);
+}
+
+int resources_get_os(coap_rw_buffer_t *scratch,
+                     const coap_packet_t *inpkt,
+                     coap_packet_t *outpkt,
+                     uint8_t id_hi, uint8_t id_lo)
+{
+    return _text_response(scratch, inpkt, outpkt, id_hi, id_lo, "riot");
+}
+
+int resources_get_board(coap_rw_buffer_t *scratch,
+                        const coap_packet_t *inpkt,
+                        coap_packet_t *outpkt,
+                        uint8_t id_hi, uint8_t id_lo)
+{
+    return _text_response(scratch, inpkt, outpkt, id_hi, id_lo, RIOT_BOARD);
+}
+
+int resources_get_mcu(coap_rw_buffer_t *scratch,
+                      const coap_packet_t *inpkt,
+                      coap_packet_t *outpkt,
+                      uint8_t id_hi, uint8_t id_lo)
+{
+    return _text_response(scratch, inpkt, outpkt, id_hi, id_lo, RIOT_MCU);
+}
+
+static int _led_is_on(void)
+{
+    return (gpio_read(LED0_PIN) == 0) == LED0_ACTIVE_LOW;
+}
+
+/* push the LED state to the broker, from the scheduler thread */
+static void _notify_led(void *arg)
+{
+    (void)arg;
+
+    /* clear first: a change made meanwhile is pushed again */
+    unsigned state = irq_disable();
+    led_pending = 0;
+    irq_restore(state);
+
+    telemetry_reading_t led_status = { "led", "", _led_is_on(), 0, 0 };
+    telemetry_send_readings(&telemetry_server, &led_status, 1);
+}
+
+int resources_get_led(coap_rw_buffer_t *scratch,
+                      const coap_packet_t *inpkt,
+                      coap_packet_t *outpkt,
+                      uint8_t id_hi, uint8_t id_lo)
+{
+    return _text_response(scratch, inpkt, outpkt, id_hi, id_lo,
+                          _led_is_on() ? "1" : "0");
+}
+
+int resources_put_led(coap_rw_buffer_t *scratch,
+                      const coap_packet_t *inpkt,
+                      coap_packet_t *outpkt,
+                      uint8_t id_hi, uint8_t id_lo)
+{
+    coap_responsecode_t resp = COAP_RSPCODE_CHANGED;
+
+    /* Check input data is valid */
+    if ((inpkt->payload.len == 1) &&
+        ((inpkt->payload.p[0] == '0') || (inpkt->payload.p[0] == '1'))) {
+        int on = (inpkt->payload.p[0] == '1');
+        /* update LED value */
+        gpio_write(LED0_PIN, LED0_ACTIVE_LOW ? !on : on);
+
+        /* Notify the server once the reply is sent: the scheduler thread
+           would preempt this one if posted now. Changes made until then are
+           pushed once, with the last state */
+        unsigned state = irq_disable();
+        int pending = led_pending;
+        led_pending = 1;
+        irq_restore(state);
+        if (!pending) {
+            scheduler_add(&led_job, _notify_led, NULL, RESOURCES_LED_HOLDOFF,
+                          0);
+        }
+    }
+    else {
+        resp = COAP_RSPCODE_BAD_REQUEST;
+    }
+
+    /* Reply to server */
+    return coap_make_response(scratch, outpkt, NULL, 0,
+                              id_hi, id_lo,
+                              &inpkt->tok, resp,
+                              COAP_CONTENTTYPE_TEXT_PLAIN);
+}
+
+int resources_get_sampling(coap_rw_buffer_t *scratch,
+                           const coap_packet_t *inpkt,
+                           coap_packet_t *outpkt,
+                           uint8_t id_hi, uint8_t id_lo)
+{
+    telemetry_reading_t readings[SCHEDULER_STATS_READINGS];
+
+    if (sampling_job == NULL) {
+        return coap_make_response(scratch, outpkt, NULL, 0, id_hi, id_lo,
+                                  &inpkt->tok, COAP_RSPCODE_NOT_FOUND,
+                                  COAP_CONTENTTYPE_TEXT_PLAIN);
+    }
+
+    unsigned count = scheduler_stats_readings(sampling_job, readings);
+    return telemetry_make_response(scratch, inpkt, outpkt, id_hi, id_lo,
+                                   readings, count);
+}
+
+int resources_get_report(coap_rw_buffer_t *scratch,
+                         const coap_packet_t *inpkt,
+                         coap_packet_t *outpkt,
+                         uint8_t id_hi, uint8_t id_lo)
+{
+    coap_responsecode_t resp = COAP_RSPCODE_CONTENT;
+    uint8_t *response = response_payload();
+    int len = 0;
+
+    if (report == NULL) {
+        resp = COAP_RSPCODE_NOT_FOUND;
+    }
+    else if ((len = report_config_print(report, (char *)response,
+                                        RESPONSE_PAYLOAD_MAX)) < 0) {
+        resp = COAP_RSPCODE_INTERNAL_ERROR;
+        len = 0;
+    }
+
+    return coap_make_response(scratch, outpkt, response, len, id_hi, id_lo,
+                              &inpkt->tok, resp, COAP_CONTENTTYPE_TEXT_PLAIN);
+}
+
+int resources_put_report(coap_rw_buffer_t *scratch,
+                         const coap_packet_t *inpkt,
+                         coap_packet_t *outpkt,
+                         uint8_t id_hi, uint8_t id_lo)
+{
+    coap_responsecode_t resp = COAP_RSPCODE_CHANGED;
+
+    if (report == NULL) {
+        resp = COAP_RSPCODE_NOT_FOUND;
+    }
+    else if (report_config_parse(report, (const char *)inpkt->payload.p,
+                                 inpkt->payload.len) < 0) {
+        resp = COAP_RSPCODE_BAD_REQUEST;
+    }
+
+    return coap_make_response(scratch, outpkt, NULL, 0, id_hi, id_lo,
+                              &inpkt->tok, resp, COAP_CONTENTTYPE_TEXT_PLAIN);
+}
+
+int resources_get_stats(coap_rw_buffer_t *scratch,
+                        const coap_packet_t *inpkt,
+                        coap_packet_t *outpkt,
+                        uint8_t id_hi, uint8_t id_lo)
+{
+    uint8_t *response = response_payload();
+    int len = stats_encode(response, RESPONSE_PAYLOAD_MAX);
+
+    if (len < 0) {
+        return coap_make_response(scratch, outpkt, NULL, 0, id_hi, id_lo,
+                                  &inpkt->tok, COAP_RSPCODE_INTERNAL_ERROR,
+                                  COAP_CONTENTTYPE_TEXT_PLAIN);
+    }
+    return coap_make_response(scratch, outpkt, response, len, id_hi, id_lo,
+                              &inpkt->tok, COAP_RSPCODE_CONTENT,
+                              (coap_content_type_t)TELEMETRY_FORMAT_CBOR);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <string.h>
+#include <coap.h>
+
+#include "response.h"
+
+#define COAP_PAYLOAD_MARKER     (0xff)
+
+static uint8_t arena[RESPONSE_HEADROOM + RESPONSE_PAYLOAD_MAX];
+
+uint8_t *response_payload(void)
+{
+    return &arena[RESPONSE_HEADROOM];
+}
+
+void response_none(coap_packet_t *pkt)
+{
+    /* a NON message is never empty, so no response is one */
+    pkt->hdr.t = COAP_TYPE_NONCON;
+    pkt->hdr.code = 0;
+    pkt->numopts = 0;
+    pkt->payload.len = 0;
+}
+
+int response_build(coap_packet_t *pkt, const uint8_t **datagram)
+{
+    uint8_t *payload = (uint8_t *)pkt->payload.p;
+    size_t payload_len = pkt->payload.len;
+    size_t len = sizeof(arena);
+    int rc;
+
+    if ((pkt->hdr.t == COAP_TYPE_NONCON) && (pkt->hdr.code == 0)) {
+        return 0;
+    }
+
+    if ((payload_len == 0) || (payload < &arena[RESPONSE_HEADROOM]) ||
+        (payload >= &arena[sizeof(arena)])) {
+        /* nothing in the arena yet, serialize as usual */
+        if ((rc = coap_build(arena, &len, pkt)) != 0) {
+            return -rc;
+        }
+        *datagram = arena;
+        return len;
+    }
+
+    /* serialize without payload at the start of the arena, what is left
+       before the payload bounds it */
+    len = payload - arena - 1;
+    pkt->payload.len = 0;
+    rc = coap_build(arena, &len, pkt);
+    pkt->payload.len = payload_len;
+    if (rc != 0) {
+        return -rc;
+    }
+
+    /* then slide it against the payload marker */
+    uint8_t *start = payload - 1 - len;
+    memmove(start, arena, len);
+    payload[-1] = COAP_PAYLOAD_MARKER;
+    *datagram = start;
+    return len + 1 + payload_len;
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <coap.h>
+
+#include "irq.h"
+#include "mutex.h"
+#include "net/af.h"
+#include "net/conn/udp.h"
+#include "xtimer.h"
+
+#include "coap_id.h"
+#include "coap_msg.h"
+#include "i2c_bus.h"
+#include "microcoap_conn.h"
+#include "observe.h"
+#include "response.h"
+#include "telemetry_encode.h"
+#include "sample_cache.h"
+
+#define US_PER_S                (1000000U)
+#define MAX_AGE_MAX_LEN         (4)
+#define COAP_PAYLOAD_MARKER     (0xff)
+#define COAP_SERVER_PORT        (5683)
+
+#define COAP_RSPCODE_EMPTY                  (0)
+#define COAP_RSPCODE_SERVICE_UNAVAILABLE    MAKE_RSPCODE(5, 3)
+
+/* a fresh read, from the request to its separate response */
+typedef struct {
+    i2c_bus_req_t req;
+    scheduler_job_t job;        /* sends the response */
+    sample_cache_read_t read;
+    telemetry_reading_t reading;
+    uint8_t addr[16];
+    uint16_t port;
+    uint8_t token[SAMPLE_CACHE_TOKEN_MAX_LEN];
+    uint8_t tkl;
+    uint16_t format;
+    volatile uint8_t busy;      /* set by the server, cleared once sent */
+} fresh_t;
+
+static telemetry_reading_t entries[SAMPLE_CACHE_SIZE];
+static mutex_t entries_lock = MUTEX_INIT;
+static const scheduler_job_t *sampling_job = NULL;
+
+static fresh_t fresh[SAMPLE_CACHE_FRESH_MAX];
+static uint8_t separate_buf[SAMPLE_CACHE_BUF_SIZE];
+
+/* option value referenced by the response until it is built */
+static uint8_t max_age_opt[MAX_AGE_MAX_LEN];
+
+static const coap_buffer_t no_token = { NULL, 0 };
+
+void sample_cache_init(const scheduler_job_t *sampling)
+{
+    sampling_job = sampling;
+}
+
+/* to be called with the lock held */
+static telemetry_reading_t *_find(const char *name)
+{
+    for (unsigned i = 0; i < SAMPLE_CACHE_SIZE; i++) {
+        if ((entries[i].name != NULL) &&
+            (strcmp(entries[i].name, name) == 0)) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+/* to be called with the lock held */
+static telemetry_reading_t *_find_free(void)
+{
+    for (unsigned i = 0; i < SAMPLE_CACHE_SIZE; i++) {
+        if (entries[i].name == NULL) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+void sample_cache_put(const telemetry_reading_t *reading)
+{
+    mutex_lock(&entries_lock);
+    telemetry_reading_t *entry = _find(reading->name);
+    if (entry == NULL) {
+        entry = _find_free();
+    }
+    if (entry != NULL) {
+        *entry = *reading;
+    }
+    mutex_unlock(&entries_lock);
+}
+
+static int _get(const char *name, telemetry_reading_t *reading)
+{
+    int hit = 0;
+
+    mutex_lock(&entries_lock);
+    const telemetry_reading_t *entry = _find(name);
+    if (entry != NULL) {
+        *reading = *entry;
+        hit = 1;
+    }
+    mutex_unlock(&entries_lock);
+    return hit;
+}
+
+/* whether @p pkt carries the "fresh" Uri-Query */
+static int _fresh(const coap_packet_t *pkt)
+{
+    uint8_t count;
+    const coap_option_t *opt = coap_findOptions(pkt, COAP_OPTION_URI_QUERY,
+                                                &count);
+    size_t len = strlen(SAMPLE_CACHE_QUERY);
+
+    for (unsigned i = 0; (opt != NULL) && (i < count); i++) {
+        if ((opt[i].buf.len == len) &&
+            (memcmp(opt[i].buf.p, SAMPLE_CACHE_QUERY, len) == 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* seconds until the cached readings get replaced */
+static uint32_t _max_age(void)
+{
+    if (sampling_job == NULL) {
+        return 0;
+    }
+
+    /* the scheduler thread moves the deadline with interrupts disabled */
+    unsigned state = irq_disable();
+    int32_t left = (int32_t)(sampling_job->deadline - xtimer_now_usec());
+    irq_restore(state);
+
+    /* rounded down, a client never keeps a value past the next sample */
+    return (left > 0) ? (uint32_t)left / US_PER_S : 0;
+}
+
+/* an empty value is a Max-Age of 0, not the default of 60 s */
+static void _add_max_age(coap_packet_t *pkt, uint32_t max_age)
+{
+    unsigned len = coap_msg_uint_len(max_age);
+
+    coap_msg_put_uint(max_age_opt, max_age, len);
+    coap_msg_add_option(pkt, COAP_OPTION_MAX_AGE, max_age_opt, len);
+}
+
+static int _send(fresh_t *f, size_t len)
+{
+    return conn_udp_sendto(separate_buf, len, NULL, 0,
+                           f->addr, sizeof(f->addr), AF_INET6,
+                           COAP_SERVER_PORT, f->port);
+}
+
+static int _send_fresh(fresh_t *f)
+{
+    uint8_t *p = separate_buf;
+    uint32_t max_age = _max_age();
+    unsigned format_len = coap_msg_uint_len(f->format);
+    unsigned max_age_len = coap_msg_uint_len(max_age);
+    uint16_t id = coap_id_next();
+
+    *p++ = (1 << 6) | (COAP_TYPE_NONCON << 4) | f->tkl;
+    *p++ = (f->req.res < 0) ? COAP_RSPCODE_SERVICE_UNAVAILABLE
+                            : COAP_RSPCODE_CONTENT;
+    *p++ = id >> 8;
+    *p++ = id & 0xff;
+    memcpy(p, f->token, f->tkl);
+    p += f->tkl;
+
+    if (f->req.res < 0) {
+        /* the sensor did not answer, no value */
+        return _send(f, p - separate_buf);
+    }
+
+    /* Content-Format then Max-Age, both deltas fit in the option nibble */
+    *p++ = (COAP_OPTION_CONTENT_FORMAT << 4) | format_len;
+    p = coap_msg_put_uint(p, f->format, format_len);
+    *p++ = ((COAP_OPTION_MAX_AGE - COAP_OPTION_CONTENT_FORMAT) << 4) |
+           max_age_len;
+    p = coap_msg_put_uint(p, max_age, max_age_len);
+    *p++ = COAP_PAYLOAD_MARKER;
+
+    int res = telemetry_encode_response(f->format, &f->reading, 1, p,
+                                        sizeof(separate_buf) -
+                                        (p - separate_buf));
+    if (res < 0) {
+        puts("Error: fresh reading too large");
+        return res;
+    }
+
+    return _send(f, (p - separate_buf) + res);
+}
+
+/* scheduler job, sends the separate response of a fresh read */
+static void _fresh_job(void *arg)
+{
+    fresh_t *f = arg;
+
+    _send_fresh(f);
+    f->busy = 0;
+}
+
+/* I2C transaction of a fresh read */
+static int _fresh_read(void *arg)
+{
+    fresh_t *f = arg;
+
+    int res = f->read(&f->reading);
+    f->reading.time = xtimer_now_usec();
+    return res;
+}
+
+/* run by the I2C bus worker, hands the reading to the scheduler thread */
+static void _fresh_done(i2c_bus_req_t *req)
+{
+    fresh_t *f = (fresh_t *)req;
+
+    if (!scheduler_post(&f->job)) {
+        puts("Error: cannot send fresh reading, scheduler queue full");
+        f->busy = 0;
+    }
+}
+
+static fresh_t *_fresh_alloc(void)
+{
+    for (unsigned i = 0; i < SAMPLE_CACHE_FRESH_MAX; i++) {
+        /* slots are only taken by the server thread */
+        if (!fresh[i].busy) {
+            fresh[i].busy = 1;
+            return &fresh[i];
+        }
+    }
+    return NULL;
+}
+
+static int _respond_fresh(coap_rw_buffer_t *scratch,
+                          const coap_packet_t *inpkt,
+                          coap_packet_t *outpkt,
+                          uint8_t id_hi, uint8_t id_lo,
+                          sample_cache_read_t read)
+{
+    uint16_t format = telemetry_accept_format(inpkt);
+
+    if (!telemetry_format_supported(format)) {
+        return coap_msg_reply(scratch, inpkt, outpkt,
+                              COAP_RSPCODE_NOT_ACCEPTABLE);
+    }
+    if (inpkt->tok.len > SAMPLE_CACHE_TOKEN_MAX_LEN) {
+        return coap_msg_reply(scratch, inpkt, outpkt,
+                              COAP_RSPCODE_BAD_REQUEST);
+    }
+
+    fresh_t *f = _fresh_alloc();
+    if (f == NULL) {
+        int res = coap_msg_reply(scratch, inpkt, outpkt,
+                                 COAP_RSPCODE_SERVICE_UNAVAILABLE);
+        _add_max_age(outpkt, 1);
+        return res;
+    }
+
+    size_t addr_len;
+    microcoap_remote(f->addr, &addr_len, &f->port);
+    memcpy(f->token, inpkt->tok.p, inpkt->tok.len);
+    f->tkl = inpkt->tok.len;
+    f->format = format;
+    f->read = read;
+    scheduler_job_init(&f->job, _fresh_job, f);
+    i2c_bus_req_init(&f->req, _fresh_read, f, _fresh_done);
+
+    if (i2c_bus_submit(&f->req) < 0) {
+        f->busy = 0;
+        int res = coap_msg_reply(scratch, inpkt, outpkt,
+                                 COAP_RSPCODE_SERVICE_UNAVAILABLE);
+        _add_max_age(outpkt, 1);
+        return res;
+    }
+
+    if (inpkt->hdr.t != COAP_TYPE_CON) {
+        /* nothing to acknowledge, only the separate response is sent */
+        response_none(outpkt);
+        return 0;
+    }
+
+    /* empty ACK, the reading follows in a separate response */
+    coap_make_response(scratch, outpkt, NULL, 0, id_hi, id_lo, &no_token,
+                       COAP_RSPCODE_EMPTY, COAP_CONTENTTYPE_TEXT_PLAIN);
+    outpkt->numopts = 0;
+    return 0;
+}
+
+int sample_cache_respond(coap_rw_buffer_t *scratch,
+                         const coap_packet_t *inpkt,
+                         coap_packet_t *outpkt,
+                         uint8_t id_hi, uint8_t id_lo,
+                         const char *name, sample_cache_read_t read)
+{
+    telemetry_reading_t reading;
+
+    if (_fresh(inpkt)) {
+        return _respond_fresh(scratch, inpkt, outpkt, id_hi, id_lo, read);
+    }
+
+    if (!_get(name, &reading)) {
+        /* nothing sampled yet, retry once it is */
+        int res = coap_msg_reply(scratch, inpkt, outpkt,
+                                 COAP_RSPCODE_SERVICE_UNAVAILABLE);
+        _add_max_age(outpkt, _max_age());
+        return res;
+    }
+
+    int res = observe_make_response(scratch, inpkt, outpkt, id_hi, id_lo,
+                                    reading.name, &reading, 1);
+    if ((res == 0) && (outpkt->hdr.code == COAP_RSPCODE_CONTENT)) {
+        _add_max_age(outpkt, _max_age());
+    }
+    return res;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifdef MODULE_SAUL_REG
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "saul_sampler.h"
+#include "stats.h"
+
+static int _resolve(saul_sampler_t *sampler)
+{
+    for (unsigned i = 0; i < sampler->count; i++) {
+        sampler->devs[i] = saul_reg_find_type(sampler->types[i]);
+        if (sampler->devs[i] == NULL) {
+            printf("Error: no SAUL device of type 0x%02x\n",
+                   sampler->types[i]);
+            return -ENODEV;
+        }
+    }
+    sampler->resolved = 1;
+    return 0;
+}
+
+int saul_sampler_init(saul_sampler_t *sampler, const uint8_t *types,
+                      unsigned count)
+{
+    if (count > SAUL_SAMPLER_MAX) {
+        return -EINVAL;
+    }
+    sampler->types = types;
+    sampler->count = count;
+    sampler->resolved = 0;
+
+    return _resolve(sampler);
+}
+
+int saul_sampler_read(saul_sampler_t *sampler, phydat_t *data)
+{
+    if (!sampler->resolved && (_resolve(sampler) < 0)) {
+        return -ENODEV;
+    }
+
+    for (unsigned i = 0; i < sampler->count; i++) {
+        uint32_t start = stats_now();
+        int res = saul_reg_read(sampler->devs[i], &data[i]);
+        stats_record(STATS_SENSOR, start);
+        if (res < 0) {
+            /* the device may be gone, look it up again next time */
+            printf("Error: reading SAUL device '%s' failed\n",
+                   sampler->devs[i]->name);
+            sampler->resolved = 0;
+            return -EIO;
+        }
+    }
+    return 0;
+}
+
+#endif /* MODULE_SAUL_REG */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "irq.h"
+#include "msg.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "scheduler.h"
+
+#define SCHEDULER_MSG_TIMER     (0x5301)    /* earliest deadline reached */
+#define SCHEDULER_MSG_WAKEUP    (0x5302)    /* job list changed */
+#define SCHEDULER_MSG_RUN       (0x5303)    /* run a posted job */
+
+static char scheduler_stack[SCHEDULER_STACKSIZE];
+static msg_t scheduler_queue[SCHEDULER_QUEUE_SIZE];
+static kernel_pid_t scheduler_pid = KERNEL_PID_UNDEF;
+
+static scheduler_job_t *jobs = NULL;        /* ordered by deadline */
+static xtimer_t timer;
+static msg_t timer_msg;
+
+/* whether deadline @p a comes before @p b, xtimer wrap-around safe */
+static inline int _before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+/* to be called with interrupts disabled */
+static void _unlink(scheduler_job_t *job)
+{
+    for (scheduler_job_t **p = &jobs; *p != NULL; p = &(*p)->next) {
+        if (*p == job) {
+            *p = job->next;
+            return;
+        }
+    }
+}
+
+/* to be called with interrupts disabled */
+static void _insert(scheduler_job_t *job)
+{
+    scheduler_job_t **p = &jobs;
+
+    while ((*p != NULL) && !_before(job->deadline, (*p)->deadline)) {
+        p = &(*p)->next;
+    }
+    job->next = *p;
+    *p = job;
+}
+
+static void _wakeup(void)
+{
+    msg_t msg;
+
+    /* the scheduler thread re-arms its timer after each job anyway */
+    if ((scheduler_pid == KERNEL_PID_UNDEF) ||
+        (thread_getpid() == scheduler_pid)) {
+        return;
+    }
+    msg.type = SCHEDULER_MSG_WAKEUP;
+    msg_try_send(&msg, scheduler_pid);
+}
+
+void scheduler_job_init(scheduler_job_t *job, scheduler_cb_t cb, void *arg)
+{
+    job->next = NULL;
+    job->cb = cb;
+    job->arg = arg;
+    job->deadline = 0;
+    job->period = 0;
+    job->due = 0;
+    memset(&job->stats, 0, sizeof(job->stats));
+}
+
+void scheduler_add(scheduler_job_t *job, scheduler_cb_t cb, void *arg,
+                   uint32_t delay, uint32_t period)
+{
+    unsigned state = irq_disable();
+    _unlink(job);
+    job->cb = cb;
+    job->arg = arg;
+    job->period = period;
+    job->deadline = xtimer_now_usec() + delay;
+    memset(&job->stats, 0, sizeof(job->stats));
+    _insert(job);
+    irq_restore(state);
+
+    _wakeup();
+}
+
+void scheduler_remove(scheduler_job_t *job)
+{
+    unsigned state = irq_disable();
+    _unlink(job);
+    irq_restore(state);
+}
+
+int scheduler_post(scheduler_job_t *job)
+{
+    msg_t msg;
+
+    if (scheduler_pid == KERNEL_PID_UNDEF) {
+        return 0;
+    }
+    msg.type = SCHEDULER_MSG_RUN;
+    msg.content.ptr = job;
+    return msg_try_send(&msg, scheduler_pid) == 1;
+}
+
+/* to be called with interrupts disabled */
+static void _account(scheduler_job_t *job, uint32_t now)
+{
+    uint32_t late = now - job->due;
+
+    job->stats.runs++;
+    job->stats.late_sum += late;
+    if (late > job->stats.late_max) {
+        job->stats.late_max = late;
+    }
+}
+
+/* run the jobs whose deadline has passed, then arm the timer for the next */
+static void _run_due(void)
+{
+    for (;;) {
+        unsigned state = irq_disable();
+        scheduler_job_t *job = jobs;
+        uint32_t now = xtimer_now_usec();
+
+        if (job == NULL) {
+            irq_restore(state);
+            xtimer_remove(&timer);
+            return;
+        }
+        if (_before(now, job->deadline)) {
+            irq_restore(state);
+            xtimer_set_msg(&timer, job->deadline - now, &timer_msg,
+                           scheduler_pid);
+            return;
+        }
+
+        jobs = job->next;
+        job->due = job->deadline;
+        _account(job, now);
+        if (job->period > 0) {
+            /* stay on the period grid, skipping the runs already missed */
+            job->deadline += job->period;
+            while (!_before(now, job->deadline)) {
+                job->deadline += job->period;
+                job->stats.missed++;
+            }
+            _insert(job);
+        }
+        irq_restore(state);
+
+        job->cb(job->arg);
+    }
+}
+
+static void *_scheduler_thread(void *arg)
+{
+    (void)arg;
+    msg_t msg;
+
+    /* set here too, the thread runs before thread_create() returns */
+    scheduler_pid = thread_getpid();
+    msg_init_queue(scheduler_queue, SCHEDULER_QUEUE_SIZE);
+    timer_msg.type = SCHEDULER_MSG_TIMER;
+
+    for (;;) {
+        _run_due();
+        msg_receive(&msg);
+
+        if (msg.type == SCHEDULER_MSG_RUN) {
+            scheduler_job_t *job = msg.content.ptr;
+            job->due = xtimer_now_usec();
+            job->cb(job->arg);
+        }
+    }
+
+    return NULL;
+}
+
+unsigned scheduler_stats_readings(const scheduler_job_t *job,
+                                  telemetry_reading_t *readings)
+{
+    scheduler_stats_t stats;
+
+    /* the scheduler thread may update them meanwhile */
+    unsigned state = irq_disable();
+    stats = job->stats;
+    irq_restore(state);
+
+    uint32_t mean = (stats.runs > 0) ? (uint32_t)(stats.late_sum / stats.runs)
+                                     : 0;
+    readings[0] = (telemetry_reading_t) { "runs", "", stats.runs, 0, 0 };
+    readings[1] = (telemetry_reading_t) { "missed", "", stats.missed, 0, 0 };
+    readings[2] = (telemetry_reading_t) { "late_mean", "us", mean, 0, 0 };
+    readings[3] = (telemetry_reading_t) {
+        "late_max", "us", stats.late_max, 0, 0
+    };
+    return SCHEDULER_STATS_READINGS;
+}
+
+kernel_pid_t scheduler_start(void)
+{
+    scheduler_pid = thread_create(scheduler_stack, sizeof(scheduler_stack),
+                                  THREAD_PRIORITY_MAIN - 1,
+                                  THREAD_CREATE_STACKTEST, _scheduler_thread,
+                                  NULL, "Scheduler thread");
+    if (scheduler_pid == -EINVAL || scheduler_pid == -EOVERFLOW) {
+        puts("Error: failed to create scheduler thread");
+        scheduler_pid = KERNEL_PID_UNDEF;
+        return -EINVAL;
+    }
+    return scheduler_pid;
+}
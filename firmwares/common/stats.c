@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdio.h>
+
+#include "irq.h"
+#include "thread.h"
+
+#include "cbor.h"
+#include "telemetry.h"
+#include "stats.h"
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define TICKS_PER_US            (CLOCK_CORECLOCK / 1000000U)
+#else
+#define TICKS_PER_US            (1U)
+#endif
+
+stats_counters_t stats_counters;
+
+static stats_histogram_t histograms[STATS_TIMERS];
+
+static const char *const timer_names[STATS_TIMERS] = {
+    "parse", "dispatch", "handler", "build", "send", "sensor"
+};
+
+void stats_init(void)
+{
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+static unsigned _bucket(uint32_t ns)
+{
+    uint32_t us = ns / 1000U;
+    unsigned bucket = 0;
+
+    while ((us >>= 1) && (bucket < STATS_BUCKETS - 1)) {
+        bucket++;
+    }
+    return bucket;
+}
+
+void stats_record(stats_timer_t timer, uint32_t start)
+{
+    uint64_t ns = (uint64_t)(stats_now() - start) * 1000U / TICKS_PER_US;
+    stats_histogram_t *hist = &histograms[timer];
+
+    if (ns > UINT32_MAX) {
+        ns = UINT32_MAX;
+    }
+
+    /* sensor reads are timed from the scheduler and server threads */
+    unsigned state = irq_disable();
+    hist->count++;
+    hist->sum += ns;
+    if (ns > hist->max) {
+        hist->max = ns;
+    }
+    hist->buckets[_bucket(ns)]++;
+    irq_restore(state);
+}
+
+/* first and last non-empty bucket of @p hist, both 0 if it is empty */
+static void _bucket_range(const stats_histogram_t *hist, unsigned *first,
+                          unsigned *last)
+{
+    *first = STATS_BUCKETS;
+    *last = 0;
+    for (unsigned i = 0; i < STATS_BUCKETS; i++) {
+        if (hist->buckets[i] > 0) {
+            *first = (*first == STATS_BUCKETS) ? i : *first;
+            *last = i;
+        }
+    }
+    if (*first == STATS_BUCKETS) {
+        *first = 0;
+    }
+}
+
+static void _snapshot(stats_timer_t timer, stats_histogram_t *hist)
+{
+    unsigned state = irq_disable();
+    *hist = histograms[timer];
+    irq_restore(state);
+}
+
+static uint32_t _mean(const stats_histogram_t *hist)
+{
+    return (hist->count > 0) ? (uint32_t)(hist->sum / hist->count) : 0;
+}
+
+#ifdef DEVELHELP
+/* number of threads, and their stack usage with @p writer if not NULL */
+static unsigned _put_stacks(cbor_writer_t *writer)
+{
+    unsigned count = 0;
+
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        thread_t *thread = (thread_t *)thread_get(pid);
+        if (thread == NULL) {
+            continue;
+        }
+        count++;
+        if (writer != NULL) {
+            uintptr_t unused =
+                thread_measure_stack_free(thread->stack_start);
+            cbor_put_text(writer, thread->name);
+            cbor_put_array(writer, 2);
+            cbor_put_uint(writer, thread->stack_size - unused);
+            cbor_put_uint(writer, thread->stack_size);
+        }
+    }
+    return count;
+}
+#endif
+
+int stats_encode(uint8_t *buf, size_t len)
+{
+    cbor_writer_t writer;
+
+    cbor_writer_init(&writer, buf, len);
+#ifdef DEVELHELP
+    cbor_put_map(&writer, 9);
+#else
+    cbor_put_map(&writer, 8);
+#endif
+    cbor_put_text(&writer, "req");
+    cbor_put_uint(&writer, stats_counters.requests);
+    cbor_put_text(&writer, "perr");
+    cbor_put_uint(&writer, stats_counters.parse_errors);
+    cbor_put_text(&writer, "berr");
+    cbor_put_uint(&writer, stats_counters.build_errors);
+    cbor_put_text(&writer, "serr");
+    cbor_put_uint(&writer, stats_counters.send_errors);
+    cbor_put_text(&writer, "push");
+    cbor_put_uint(&writer, telemetry_stats.sent);
+    cbor_put_text(&writer, "pusherr");
+    cbor_put_uint(&writer, telemetry_stats.send_errors);
+    cbor_put_text(&writer, "pushdrop");
+    cbor_put_uint(&writer, telemetry_stats.dropped);
+
+    cbor_put_text(&writer, "time");
+    cbor_put_map(&writer, STATS_TIMERS);
+    for (unsigned t = 0; t < STATS_TIMERS; t++) {
+        stats_histogram_t hist;
+        unsigned first, last;
+
+        _snapshot(t, &hist);
+        _bucket_range(&hist, &first, &last);
+        cbor_put_text(&writer, timer_names[t]);
+        cbor_put_array(&writer, 4 + ((hist.count > 0) ? last - first + 1 : 0));
+        cbor_put_uint(&writer, hist.count);
+        cbor_put_uint(&writer, _mean(&hist));
+        cbor_put_uint(&writer, hist.max);
+        cbor_put_uint(&writer, first);
+        for (unsigned i = first; (hist.count > 0) && (i <= last); i++) {
+            cbor_put_uint(&writer, hist.buckets[i]);
+        }
+    }
+
+#ifdef DEVELHELP
+    cbor_put_text(&writer, "stack");
+    cbor_put_map(&writer, _put_stacks(NULL));
+    _put_stacks(&writer);
+#endif
+
+    return cbor_writer_len(&writer);
+}
+
+int stats_cmd(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("requests: %lu, parse errors: %lu, build errors: %lu, "
+           "send errors: %lu\n",
+           (unsigned long)stats_counters.requests,
+           (unsigned long)stats_counters.parse_errors,
+           (unsigned long)stats_counters.build_errors,
+           (unsigned long)stats_counters.send_errors);
+    printf("pushed: %lu, push errors: %lu, push drops: %lu\n",
+           (unsigned long)telemetry_stats.sent,
+           (unsigned long)telemetry_stats.send_errors,
+           (unsigned long)telemetry_stats.dropped);
+
+    for (unsigned t = 0; t < STATS_TIMERS; t++) {
+        stats_histogram_t hist;
+        unsigned first, last;
+
+        _snapshot(t, &hist);
+        _bucket_range(&hist, &first, &last);
+        printf("%-9s count: %lu, mean: %lu ns, max: %lu ns\n", timer_names[t],
+               (unsigned long)hist.count, (unsigned long)_mean(&hist),
+               (unsigned long)hist.max);
+        for (unsigned i = first; (hist.count > 0) && (i <= last); i++) {
+            printf("    from %lu us: %lu\n", (i > 0) ? (1UL << i) : 0UL,
+                   (unsigned long)hist.buckets[i]);
+        }
+    }
+
+#ifdef DEVELHELP
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        thread_t *thread = (thread_t *)thread_get(pid);
+        if (thread == NULL) {
+            continue;
+        }
+        uintptr_t unused = thread_measure_stack_free(thread->stack_start);
+        printf("stack of %s: %lu of %u bytes used\n", thread->name,
+               (unsigned long)(thread->stack_size - unused),
+               (unsigned)thread->stack_size);
+    }
+#endif
+
+    return 0;
+}
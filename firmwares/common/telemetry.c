@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <coap.h>
+
+#include "irq.h"
+#include "net/af.h"
+#include "net/gnrc/ipv6.h"
+#include "net/conn/udp.h"
+
+#include "block.h"
+#include "coap_id.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "telemetry_con.h"
+#include "telemetry_encode.h"
+
+#define COAP_HDR_LEN            (4)
+#define COAP_PAYLOAD_MARKER     (0xff)
+
+telemetry_path_t telemetry_server;
+telemetry_path_t telemetry_alive;
+telemetry_stats_t telemetry_stats;
+
+static ipv6_addr_t broker_addr;
+static scheduler_job_t beacon_job;
+
+/* Block1 transfer in progress, a single block in flight */
+static struct {
+    const telemetry_path_t *path;
+    block_opt_t block;              /* block in flight */
+    size_t len;
+    uint8_t payload[TELEMETRY_TRANSFER_MAX];
+} transfer;
+static volatile uint8_t transfer_busy = 0;
+static scheduler_job_t *transfer_job = NULL;
+
+static void _transfer_acked(void *arg, int res, const coap_packet_t *rsp);
+
+int telemetry_path_init(telemetry_path_t *path, const char *uri_path,
+                        uint16_t format)
+{
+    size_t len = strlen(uri_path);
+    uint8_t *p = path->hdr;
+
+    if (len > TELEMETRY_PATH_MAX_LEN) {
+        printf("Error: uri path too long '%s'\n", uri_path);
+        return -EINVAL;
+    }
+
+    *p++ = (1 << 6) | ((TELEMETRY_CONFIRMABLE ? COAP_TYPE_CON
+                                              : COAP_TYPE_NONCON) << 4) |
+           TELEMETRY_TOKEN_LEN;
+    *p++ = COAP_METHOD_POST;
+    /* message ID and token, patched on each send */
+    memset(p, 0, 2 + TELEMETRY_TOKEN_LEN);
+    p += 2 + TELEMETRY_TOKEN_LEN;
+
+    /* Uri-Path is the first option, so its delta is the option number */
+    if (len < 13) {
+        *p++ = (COAP_OPTION_URI_PATH << 4) | len;
+    }
+    else {
+        *p++ = (COAP_OPTION_URI_PATH << 4) | 13;
+        *p++ = len - 13;
+    }
+    memcpy(p, uri_path, len);
+    p += len;
+
+    /* Content-Format follows with a delta of 1, zero is sent as no value */
+    if (format == 0) {
+        *p++ = (1 << 4);
+    }
+    else if (format <= 0xff) {
+        *p++ = (1 << 4) | 1;
+        *p++ = format;
+    }
+    else {
+        *p++ = (1 << 4) | 2;
+        *p++ = format >> 8;
+        *p++ = format & 0xff;
+    }
+
+    path->hdr_len = p - path->hdr;
+    path->format = format;
+    return 0;
+}
+
+int telemetry_init(void)
+{
+    /* format destination address from string */
+    if (ipv6_addr_from_str(&broker_addr, BROKER_ADDR) == NULL) {
+        printf("Error: address not valid '%s'\n", BROKER_ADDR);
+        return -1;
+    }
+
+    /* random first message ID, so that the broker does not take the
+       requests of a rebooted node for duplicates */
+    coap_id_init();
+    telemetry_con_init();
+    telemetry_path_init(&telemetry_server, "server", TELEMETRY_FORMAT);
+    telemetry_path_init(&telemetry_alive, "alive", TELEMETRY_FORMAT_TEXT);
+
+    return 0;
+}
+
+/* send one POST to @p path, with a Block1 option if @p block is set */
+static int _send_post(const telemetry_path_t *path, const block_opt_t *block,
+                      const uint8_t *payload, size_t len)
+{
+    uint8_t snd_buf[TELEMETRY_BUF_SIZE];
+    size_t pkt_len = path->hdr_len;
+
+    if (pkt_len + 2 + BLOCK_OPT_MAX_LEN + 1 + len > sizeof(snd_buf)) {
+        printf("Error: telemetry payload too large (%u bytes)\n",
+               (unsigned)len);
+        return -ENOMEM;
+    }
+
+    memcpy(snd_buf, path->hdr, path->hdr_len);
+
+    uint16_t id = coap_id_next();
+    snd_buf[2] = (uint8_t)(id >> 8);
+    snd_buf[3] = (uint8_t)(id & 0xff);
+    coap_id_token(&snd_buf[COAP_HDR_LEN], TELEMETRY_TOKEN_LEN);
+
+    if (block != NULL) {
+        /* the next block waits for the answer to this one */
+        snd_buf[0] = (snd_buf[0] & ~0x30) | (COAP_TYPE_CON << 4);
+
+        /* the header ends with Content-Format, Block1 needs an extended
+         * option delta */
+        size_t opt_len = block_put(&snd_buf[pkt_len + 2], block);
+        snd_buf[pkt_len++] = (13 << 4) | opt_len;
+        snd_buf[pkt_len++] = COAP_OPTION_BLOCK1 -
+                             COAP_OPTION_CONTENT_FORMAT - 13;
+        pkt_len += opt_len;
+    }
+
+    if (len > 0) {
+        snd_buf[pkt_len++] = COAP_PAYLOAD_MARKER;
+        memcpy(&snd_buf[pkt_len], payload, len);
+        pkt_len += len;
+    }
+
+    if (block != NULL) {
+        return telemetry_con_send(snd_buf, pkt_len, _transfer_acked, NULL);
+    }
+    if ((snd_buf[0] >> 4 & 0x03) == COAP_TYPE_CON) {
+        return telemetry_con_send(snd_buf, pkt_len, NULL, NULL);
+    }
+    return telemetry_sendto(snd_buf, pkt_len);
+}
+
+int telemetry_sendto(const uint8_t *pkt, size_t len)
+{
+    int res = conn_udp_sendto(pkt, len, NULL, 0,
+                              &broker_addr, sizeof(broker_addr),
+                              AF_INET6, TELEMETRY_SRC_PORT, BROKER_PORT);
+    telemetry_stats.sent++;
+    if (res < 0) {
+        telemetry_stats.send_errors++;
+    }
+    return res;
+}
+
+static void _transfer_end(void)
+{
+    telemetry_con_release();
+    transfer_busy = 0;
+    if (transfer_job != NULL) {
+        scheduler_post(transfer_job);
+    }
+}
+
+/* send the block of the transfer numbered transfer.block.num */
+static int _transfer_block(void)
+{
+    size_t size = BLOCK_SIZE(transfer.block.szx);
+    size_t offset = transfer.block.num * size;
+    size_t block_len = (transfer.len - offset > size) ? size
+                                                      : transfer.len - offset;
+
+    transfer.block.more = (offset + block_len < transfer.len);
+    return _send_post(transfer.path, &transfer.block,
+                      &transfer.payload[offset], block_len);
+}
+
+/* response to the block in flight, from the server or scheduler thread */
+static void _transfer_acked(void *arg, int res, const coap_packet_t *rsp)
+{
+    (void)arg;
+
+    if ((res < 0) || (rsp->hdr.code >= MAKE_RSPCODE(4, 0))) {
+        printf("Error: Block1 transfer aborted at block %u\n",
+               (unsigned)transfer.block.num);
+        _transfer_end();
+        return;
+    }
+    if (!transfer.block.more) {
+        _transfer_end();
+        return;
+    }
+
+    /* answered 2.31 Continue, carrying the block size the broker wants
+       from now on, smaller ones only (RFC 7959, section 2.3) */
+    block_opt_t ack;
+    transfer.block.num++;
+    if ((block_get(rsp, COAP_OPTION_BLOCK1, &ack) == 0) &&
+        (ack.szx < transfer.block.szx)) {
+        /* same offset, in smaller blocks */
+        transfer.block.num <<= transfer.block.szx - ack.szx;
+        transfer.block.szx = ack.szx;
+    }
+    if (_transfer_block() < 0) {
+        _transfer_end();
+    }
+}
+
+int telemetry_send(const telemetry_path_t *path,
+                   const uint8_t *payload, size_t len)
+{
+    if (len <= TELEMETRY_PAYLOAD_MAX) {
+        return _send_post(path, NULL, payload, len);
+    }
+    if (len > sizeof(transfer.payload)) {
+        printf("Error: telemetry payload too large (%u bytes)\n",
+               (unsigned)len);
+        telemetry_stats.dropped++;
+        return -ENOMEM;
+    }
+
+    unsigned state = irq_disable();
+    if (transfer_busy) {
+        irq_restore(state);
+        telemetry_stats.dropped++;
+        return -EBUSY;
+    }
+    transfer_busy = 1;
+    irq_restore(state);
+
+    /* hold an in-flight entry for all blocks, rather than finding the
+       table full midway */
+    int res = telemetry_con_reserve();
+    if (res < 0) {
+        transfer_busy = 0;
+        telemetry_stats.dropped++;
+        return res;
+    }
+
+    /* stream larger payloads in Block1 POSTs fitting a single frame, the
+       caller's buffer is free again once this returns */
+    transfer.path = path;
+    transfer.block = (block_opt_t) { 0, 0, BLOCK_SZX };
+    transfer.len = len;
+    memcpy(transfer.payload, payload, len);
+
+    res = _transfer_block();
+    if (res < 0) {
+        telemetry_con_release();
+        transfer_busy = 0;
+    }
+    return res;
+}
+
+int telemetry_transfer_busy(void)
+{
+    return transfer_busy;
+}
+
+void telemetry_transfer_notify(scheduler_job_t *job)
+{
+    transfer_job = job;
+}
+
+int telemetry_send_readings(const telemetry_path_t *path,
+                            const telemetry_reading_t *readings,
+                            unsigned count)
+{
+    uint8_t payload[TELEMETRY_PAYLOAD_MAX];
+    int res = 0;
+
+    while (count > 0) {
+        /* grow the chunk while the encoded readings still fit */
+        unsigned n = 0;
+        int len = -1;
+        while (n < count) {
+            int next = telemetry_encode(path->format, readings, n + 1,
+                                        payload, sizeof(payload));
+            if (next < 0) {
+                break;
+            }
+            len = next;
+            n++;
+        }
+        if (n == 0) {
+            printf("Error: reading '%s' too large, dropped\n",
+                   readings[0].name);
+            n = 1;
+        }
+        else {
+            /* the last successful encoding was overwritten, redo it */
+            if (n < count) {
+                len = telemetry_encode(path->format, readings, n,
+                                       payload, sizeof(payload));
+            }
+            res = telemetry_send(path, payload, len);
+        }
+        readings += n;
+        count -= n;
+    }
+
+    return res;
+}
+
+static void _beacon(void *arg)
+{
+    (void)arg;
+    telemetry_send(&telemetry_alive, (const uint8_t *)"Alive", 5);
+}
+
+void telemetry_beacon_start(void)
+{
+    scheduler_add(&beacon_job, _beacon, NULL, 0, TELEMETRY_BEACON_INTERVAL);
+}
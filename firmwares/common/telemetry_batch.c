@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "xtimer.h"
+
+#include "telemetry_batch.h"
+
+void telemetry_batch_init(telemetry_batch_t *batch,
+                          const telemetry_path_t *path,
+                          unsigned flush_cycles, uint32_t max_delay)
+{
+    batch->path = path;
+    batch->count = 0;
+    batch->cycles = 0;
+    batch->flush_cycles = flush_cycles;
+    batch->max_delay = max_delay;
+    batch->first = 0;
+}
+
+int telemetry_batch_add(telemetry_batch_t *batch,
+                        const telemetry_reading_t *reading)
+{
+    int res = 0;
+
+    if (batch->count == TELEMETRY_BATCH_MAX) {
+        res = telemetry_batch_flush(batch);
+    }
+    if (batch->count == 0) {
+        batch->first = xtimer_now_usec();
+        batch->cycles = 0;
+    }
+    batch->readings[batch->count++] = *reading;
+
+    return res;
+}
+
+int telemetry_batch_commit(telemetry_batch_t *batch)
+{
+    if (batch->count == 0) {
+        return 0;
+    }
+    /* report-on-change drops readings, so count cycles rather than
+       readings */
+    batch->cycles++;
+    if ((batch->cycles >= batch->flush_cycles) ||
+        (xtimer_now_usec() - batch->first >= batch->max_delay)) {
+        return telemetry_batch_flush(batch);
+    }
+    return 0;
+}
+
+int telemetry_batch_flush(telemetry_batch_t *batch)
+{
+    int res = telemetry_send_readings(batch->path, batch->readings,
+                                      batch->count);
+
+    batch->count = 0;
+    batch->cycles = 0;
+    return res;
+}
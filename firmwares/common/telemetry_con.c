@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <coap.h>
+
+#include "mutex.h"
+#include "xtimer.h"
+
+#include "coap_id.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "telemetry_con.h"
+
+typedef struct {
+    uint32_t first;         /* time of the first transmission */
+    uint32_t deadline;      /* time of the next resend */
+    uint32_t timeout;       /* doubled on each resend */
+    uint16_t id;            /* message ID matched by the ACK */
+    uint16_t len;           /* 0 for a free entry */
+    uint8_t retransmits;
+    uint8_t reserved;       /* kept for the blocks of a transfer */
+    uint8_t separate;       /* acknowledged, awaiting its response */
+    telemetry_con_cb_t cb;  /* run with arg once the outcome is known */
+    void *arg;
+    uint8_t pkt[TELEMETRY_BUF_SIZE];
+} con_entry_t;
+
+/* outcome of a request, reported once the table is unlocked */
+typedef struct {
+    telemetry_con_cb_t cb;
+    void *arg;
+    int res;
+} con_outcome_t;
+
+static con_entry_t inflight[TELEMETRY_CON_MAX];
+static mutex_t inflight_lock = MUTEX_INIT;
+static scheduler_job_t resend_job;
+
+/* whether time @p a comes before @p b, xtimer wrap-around safe */
+static inline int _before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static uint32_t _clamp_rto(uint32_t rto)
+{
+    if (rto < TELEMETRY_RTO_MIN) {
+        return TELEMETRY_RTO_MIN;
+    }
+    if (rto > TELEMETRY_RTO_MAX) {
+        return TELEMETRY_RTO_MAX;
+    }
+    return rto;
+}
+
+/* update the RTO with round-trip time @p rtt (us), as in RFC 6298 */
+static void _sample_rtt(uint32_t rtt)
+{
+    if (telemetry_stats.srtt == 0) {
+        telemetry_stats.srtt = rtt;
+        telemetry_stats.rttvar = rtt / 2;
+    }
+    else {
+        uint32_t delta = (telemetry_stats.srtt > rtt)
+                         ? telemetry_stats.srtt - rtt
+                         : rtt - telemetry_stats.srtt;
+        telemetry_stats.rttvar = (3 * telemetry_stats.rttvar + delta) / 4;
+        telemetry_stats.srtt = (7 * telemetry_stats.srtt + rtt) / 8;
+    }
+    telemetry_stats.rto = _clamp_rto(telemetry_stats.srtt +
+                                     4 * telemetry_stats.rttvar);
+}
+
+/* schedule the resend job at the earliest deadline, to be called locked */
+static void _arm(void)
+{
+    con_entry_t *next = NULL;
+
+    for (unsigned i = 0; i < TELEMETRY_CON_MAX; i++) {
+        if ((inflight[i].len > 0) &&
+            ((next == NULL) || _before(inflight[i].deadline, next->deadline))) {
+            next = &inflight[i];
+        }
+    }
+
+    if (next == NULL) {
+        scheduler_remove(&resend_job);
+        return;
+    }
+
+    uint32_t now = xtimer_now_usec();
+    uint32_t delay = _before(now, next->deadline) ? next->deadline - now : 0;
+    scheduler_add(&resend_job, resend_job.cb, NULL, delay, 0);
+}
+
+/* resend the requests whose timeout expired, give up after the last one */
+static void _resend(void *arg)
+{
+    (void)arg;
+    uint32_t now = xtimer_now_usec();
+    con_outcome_t expired[TELEMETRY_CON_MAX];
+    unsigned count = 0;
+
+    mutex_lock(&inflight_lock);
+    for (unsigned i = 0; i < TELEMETRY_CON_MAX; i++) {
+        con_entry_t *entry = &inflight[i];
+
+        if ((entry->len == 0) || _before(now, entry->deadline)) {
+            continue;
+        }
+        if (entry->separate) {
+            /* received, but the response never came */
+            entry->len = 0;
+            expired[count++] = (con_outcome_t) {
+                entry->cb, entry->arg, -ETIMEDOUT
+            };
+            telemetry_stats.timeouts++;
+            continue;
+        }
+        if (entry->retransmits == TELEMETRY_MAX_RETRANSMIT) {
+            entry->len = 0;
+            if (entry->cb != NULL) {
+                expired[count++] = (con_outcome_t) {
+                    entry->cb, entry->arg, -ETIMEDOUT
+                };
+            }
+            telemetry_stats.timeouts++;
+            /* the path got slower, back off new requests too */
+            telemetry_stats.rto = _clamp_rto(2 * telemetry_stats.rto);
+            continue;
+        }
+        entry->retransmits++;
+        entry->timeout *= 2;
+        entry->deadline = now + entry->timeout;
+        telemetry_stats.retransmits++;
+        telemetry_sendto(entry->pkt, entry->len);
+    }
+    _arm();
+    mutex_unlock(&inflight_lock);
+
+    /* callbacks may send the next request */
+    for (unsigned i = 0; i < count; i++) {
+        expired[i].cb(expired[i].arg, expired[i].res, NULL);
+    }
+}
+
+void telemetry_con_init(void)
+{
+    mutex_lock(&inflight_lock);
+    memset(inflight, 0, sizeof(inflight));
+    telemetry_stats.srtt = 0;
+    telemetry_stats.rttvar = 0;
+    telemetry_stats.rto = TELEMETRY_ACK_TIMEOUT;
+    scheduler_job_init(&resend_job, _resend, NULL);
+    mutex_unlock(&inflight_lock);
+}
+
+int telemetry_con_reserve(void)
+{
+    int res = -EAGAIN;
+
+    mutex_lock(&inflight_lock);
+    for (unsigned i = 0; i < TELEMETRY_CON_MAX; i++) {
+        if ((inflight[i].len == 0) && !inflight[i].reserved) {
+            inflight[i].reserved = 1;
+            res = 0;
+            break;
+        }
+    }
+    mutex_unlock(&inflight_lock);
+    return res;
+}
+
+void telemetry_con_release(void)
+{
+    mutex_lock(&inflight_lock);
+    for (unsigned i = 0; i < TELEMETRY_CON_MAX; i++) {
+        inflight[i].reserved = 0;
+    }
+    mutex_unlock(&inflight_lock);
+}
+
+int telemetry_con_send(uint8_t *pkt, size_t len, telemetry_con_cb_t cb,
+                       void *arg)
+{
+    con_entry_t *entry = NULL;
+
+    mutex_lock(&inflight_lock);
+    for (unsigned i = 0; i < TELEMETRY_CON_MAX; i++) {
+        /* blocks take the reserved entry, other requests the free ones */
+        if ((inflight[i].len == 0) &&
+            (inflight[i].reserved == (cb != NULL))) {
+            entry = &inflight[i];
+            break;
+        }
+    }
+
+    if ((entry == NULL) || (len > sizeof(entry->pkt))) {
+        mutex_unlock(&inflight_lock);
+        if (cb != NULL) {
+            /* no reservation, its outcome would never come */
+            return -EAGAIN;
+        }
+        /* nothing left to retransmit it from, still try once */
+        pkt[0] = (pkt[0] & ~0x30) | (COAP_TYPE_NONCON << 4);
+        return telemetry_sendto(pkt, len);
+    }
+
+    /* the first timeout is drawn from [RTO, 1.5 * RTO], ACK_RANDOM_FACTOR
+       keeps nodes that sampled together from resending together */
+    uint32_t rto = telemetry_stats.rto;
+    memcpy(entry->pkt, pkt, len);
+    entry->len = len;
+    entry->id = (pkt[2] << 8) | pkt[3];
+    entry->retransmits = 0;
+    entry->separate = 0;
+    entry->cb = cb;
+    entry->arg = arg;
+    entry->timeout = rto + coap_id_random() % (rto / 2 + 1);
+    entry->first = xtimer_now_usec();
+    entry->deadline = entry->first + entry->timeout;
+    _arm();
+    mutex_unlock(&inflight_lock);
+
+    /* recorded first, so that an early ACK finds it */
+    int res = telemetry_sendto(pkt, len);
+    return (cb != NULL) ? 0 : res;
+}
+
+/* whether @p pkt carries the token of the request kept in @p entry */
+static int _token_match(const con_entry_t *entry, const coap_packet_t *pkt)
+{
+    return (pkt->tok.len == (entry->pkt[0] & 0x0f)) &&
+           (memcmp(pkt->tok.p, &entry->pkt[4], pkt->tok.len) == 0);
+}
+
+int telemetry_con_ack(const coap_packet_t *pkt)
+{
+    uint16_t id = (pkt->hdr.id[0] << 8) | pkt->hdr.id[1];
+    int separate = (pkt->hdr.t == COAP_TYPE_CON) ||
+                   (pkt->hdr.t == COAP_TYPE_NONCON);
+    uint32_t now = xtimer_now_usec();
+    con_outcome_t outcome = { NULL, NULL, 0 };
+    int found = 0;
+
+    mutex_lock(&inflight_lock);
+    for (unsigned i = 0; i < TELEMETRY_CON_MAX; i++) {
+        con_entry_t *entry = &inflight[i];
+
+        if ((entry->len == 0) || (entry->separate != separate)) {
+            continue;
+        }
+        if (separate) {
+            /* a separate response only echoes the token */
+            if (!_token_match(entry, pkt)) {
+                continue;
+            }
+        }
+        /* a piggybacked response echoes the token, an empty ACK has none */
+        else if ((entry->id != id) ||
+                 ((pkt->tok.len > 0) && !_token_match(entry, pkt))) {
+            continue;
+        }
+        found = 1;
+        if (!separate) {
+            /* Karn: the ACK of a resent request may answer any copy of it */
+            if (entry->retransmits == 0) {
+                _sample_rtt(now - entry->first);
+            }
+            if (pkt->hdr.t == COAP_TYPE_ACK) {
+                telemetry_stats.acked++;
+            }
+        }
+        if ((pkt->hdr.t == COAP_TYPE_ACK) && (pkt->hdr.code == 0) &&
+            (entry->cb != NULL)) {
+            /* the outcome comes in a separate response, stop resending */
+            entry->separate = 1;
+            entry->deadline = now + TELEMETRY_RESPONSE_TIMEOUT;
+            break;
+        }
+        outcome = (con_outcome_t) {
+            entry->cb, entry->arg,
+            (pkt->hdr.t == COAP_TYPE_RESET) ? -ECONNRESET : 0
+        };
+        entry->len = 0;
+        break;
+    }
+    if (found) {
+        _arm();
+    }
+    mutex_unlock(&inflight_lock);
+
+    if (outcome.cb != NULL) {
+        outcome.cb(outcome.arg, outcome.res, pkt);
+    }
+    return found;
+}
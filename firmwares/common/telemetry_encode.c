@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "xtimer.h"
+#include "cbor.h"
+#include "coap_msg.h"
+#include "fixed.h"
+#include "response.h"
+#include "telemetry_encode.h"
+
+/* SenML labels (RFC 8428) */
+#define SENML_NAME      (0)
+#define SENML_UNIT      (1)
+#define SENML_VALUE     (2)
+#define SENML_TIME      (6)
+
+/* SenML units for the units used in text form, with the decimal shift to
+ * apply to the scale (1 hPa is 10^2 Pa) */
+static const struct {
+    const char *unit;
+    const char *senml;
+    int8_t shift;
+} senml_units[] = {
+    { "°C",  "Cel", 0 },
+    { "hPa", "Pa",  2 },
+    { "%",   "%RH", 0 },
+    { "lx",  "lx",  0 },
+};
+
+bool telemetry_format_supported(uint16_t format)
+{
+    return (format == TELEMETRY_FORMAT_TEXT) ||
+           (format == TELEMETRY_FORMAT_CBOR) ||
+           (format == TELEMETRY_FORMAT_SENML_CBOR);
+}
+
+int telemetry_value_fmt(char *buf, size_t len,
+                        const telemetry_reading_t *reading)
+{
+    int res = fixed_fmt(buf, len, reading->value, reading->scale);
+    size_t unit_len = strlen(reading->unit);
+
+    if ((res < 0) || ((size_t)res + unit_len >= len)) {
+        return -1;
+    }
+    memcpy(&buf[res], reading->unit, unit_len + 1);
+    return res + unit_len;
+}
+
+static int _encode_text(const telemetry_reading_t *readings, unsigned count,
+                        uint8_t *buf, size_t len)
+{
+    char *p = (char *)buf;
+    size_t left = len;
+
+    for (unsigned i = 0; i < count; i++) {
+        /* "name:" with a newline separating readings */
+        int res = snprintf(p, left, "%s%s:", (i > 0) ? "\n" : "",
+                           readings[i].name);
+        if ((res < 0) || ((size_t)res >= left)) {
+            return -1;
+        }
+        p += res;
+        left -= res;
+
+        /* snprintf needs room for the terminating NUL, which is not sent */
+        char value[24];
+        res = telemetry_value_fmt(value, sizeof(value), &readings[i]);
+        if ((res < 0) || ((size_t)res > left)) {
+            return -1;
+        }
+        memcpy(p, value, res);
+        p += res;
+        left -= res;
+    }
+
+    return len - left;
+}
+
+static void _put_value(cbor_writer_t *writer, int32_t value, int8_t scale)
+{
+    if (scale == 0) {
+        cbor_put_int(writer, value);
+    }
+    else {
+        cbor_put_tag(writer, CBOR_TAG_DECIMAL_FRACTION);
+        cbor_put_array(writer, 2);
+        cbor_put_int(writer, scale);
+        cbor_put_int(writer, value);
+    }
+}
+
+/* seconds from the encoding time @p now to the reading time, 0 if the
+ * reading has none */
+static void _put_time(cbor_writer_t *writer, const telemetry_reading_t *reading,
+                      uint32_t now)
+{
+    if (reading->time == 0) {
+        cbor_put_int(writer, 0);
+    }
+    else {
+        _put_value(writer, (int32_t)(reading->time - now), -6);
+    }
+}
+
+static int _encode_cbor(const telemetry_reading_t *readings, unsigned count,
+                        uint8_t *buf, size_t len)
+{
+    cbor_writer_t writer;
+    uint32_t now = xtimer_now_usec();
+
+    /* a batch holds the same metric once per cycle, so no map by name */
+    cbor_writer_init(&writer, buf, len);
+    cbor_put_array(&writer, count);
+    for (unsigned i = 0; i < count; i++) {
+        cbor_put_array(&writer, 3);
+        cbor_put_text(&writer, readings[i].name);
+        _put_value(&writer, readings[i].value, readings[i].scale);
+        _put_time(&writer, &readings[i], now);
+    }
+
+    return cbor_writer_len(&writer);
+}
+
+static int _encode_senml_cbor(const telemetry_reading_t *readings,
+                              unsigned count, uint8_t *buf, size_t len)
+{
+    cbor_writer_t writer;
+    uint32_t now = xtimer_now_usec();
+
+    cbor_writer_init(&writer, buf, len);
+    cbor_put_array(&writer, count);
+    for (unsigned i = 0; i < count; i++) {
+        const char *unit = readings[i].unit;
+        int8_t scale = readings[i].scale;
+        unsigned fields = 2;
+
+        for (unsigned u = 0; u < sizeof(senml_units) / sizeof(senml_units[0]); u++) {
+            if (strcmp(unit, senml_units[u].unit) == 0) {
+                unit = senml_units[u].senml;
+                scale += senml_units[u].shift;
+                break;
+            }
+        }
+
+        fields += (*unit != '\0') + (readings[i].time != 0);
+        cbor_put_map(&writer, fields);
+        cbor_put_int(&writer, SENML_NAME);
+        cbor_put_text(&writer, readings[i].name);
+        if (*unit != '\0') {
+            cbor_put_int(&writer, SENML_UNIT);
+            cbor_put_text(&writer, unit);
+        }
+        cbor_put_int(&writer, SENML_VALUE);
+        _put_value(&writer, readings[i].value, scale);
+        if (readings[i].time != 0) {
+            /* negative times are relative to the time of reception */
+            cbor_put_int(&writer, SENML_TIME);
+            _put_time(&writer, &readings[i], now);
+        }
+    }
+
+    return cbor_writer_len(&writer);
+}
+
+int telemetry_encode(uint16_t format, const telemetry_reading_t *readings,
+                     unsigned count, uint8_t *buf, size_t len)
+{
+    switch (format) {
+        case TELEMETRY_FORMAT_TEXT:
+            return _encode_text(readings, count, buf, len);
+        case TELEMETRY_FORMAT_CBOR:
+            return _encode_cbor(readings, count, buf, len);
+        case TELEMETRY_FORMAT_SENML_CBOR:
+            return _encode_senml_cbor(readings, count, buf, len);
+        default:
+            return -1;
+    }
+}
+
+int telemetry_encode_response(uint16_t format,
+                              const telemetry_reading_t *readings,
+                              unsigned count, uint8_t *buf, size_t len)
+{
+    if ((format == TELEMETRY_FORMAT_TEXT) && (count == 1)) {
+        return telemetry_value_fmt((char *)buf, len, readings);
+    }
+    return telemetry_encode(format, readings, count, buf, len);
+}
+
+uint16_t telemetry_accept_format(const coap_packet_t *pkt)
+{
+    uint8_t count;
+    const coap_option_t *opt = coap_findOptions(pkt, COAP_OPTION_ACCEPT,
+                                                &count);
+
+    if (opt == NULL) {
+        return TELEMETRY_FORMAT_TEXT;
+    }
+    return coap_msg_get_uint(opt);
+}
+
+int telemetry_make_response(coap_rw_buffer_t *scratch,
+                            const coap_packet_t *inpkt,
+                            coap_packet_t *outpkt,
+                            uint8_t id_hi, uint8_t id_lo,
+                            const telemetry_reading_t *readings,
+                            unsigned count)
+{
+    uint16_t format = telemetry_accept_format(inpkt);
+    uint8_t *buf = response_payload();
+
+    if (!telemetry_format_supported(format)) {
+        return coap_make_response(scratch, outpkt, NULL, 0,
+                                  id_hi, id_lo, &inpkt->tok,
+                                  COAP_RSPCODE_NOT_ACCEPTABLE,
+                                  COAP_CONTENTTYPE_TEXT_PLAIN);
+    }
+
+    int res = telemetry_encode_response(format, readings, count, buf,
+                                        RESPONSE_PAYLOAD_MAX);
+    if (res < 0) {
+        return coap_make_response(scratch, outpkt, NULL, 0,
+                                  id_hi, id_lo, &inpkt->tok,
+                                  COAP_RSPCODE_INTERNAL_ERROR,
+                                  COAP_CONTENTTYPE_TEXT_PLAIN);
+    }
+    return coap_make_response(scratch, outpkt, buf, res,
+                              id_hi, id_lo, &inpkt->tok,
+                              COAP_RSPCODE_CONTENT,
+                              (coap_content_type_t)format);
+}
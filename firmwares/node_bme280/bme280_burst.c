@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "irq.h"
+#include "periph/i2c.h"
+#include "xtimer.h"
+
+#include "i2c_bus.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "bme280_burst.h"
+
+#define BME280_CHIP_ID          (0x60)
+#define BME280_RESET_WORD       (0xB6)
+
+#define BME280_REG_CALIB_TP     (0x88)  /* T and P words, then H1 at 0xA1 */
+#define BME280_CALIB_TP_LEN     (26)
+#define BME280_REG_CHIP_ID      (0xD0)
+#define BME280_REG_RESET        (0xE0)
+#define BME280_REG_CALIB_H      (0xE1)
+#define BME280_CALIB_H_LEN      (7)
+#define BME280_REG_CTRL_HUM     (0xF2)
+#define BME280_REG_STATUS       (0xF3)
+#define BME280_REG_CTRL_MEAS    (0xF4)
+#define BME280_REG_CONFIG       (0xF5)
+#define BME280_REG_DATA         (0xF7)  /* press, temp and hum, to 0xFE */
+#define BME280_DATA_LEN         (8)
+
+#define BME280_STATUS_MEASURING (0x08)
+#define BME280_STARTUP_TIME     (2000U)     /* us, after a reset */
+#define BME280_POLL_TIME        (1000U)     /* us */
+#define BME280_POLL_MAX         (10)
+
+typedef struct {
+    bme280_mode_t mode;
+    bme280_osrs_t osrs_t;
+    bme280_osrs_t osrs_p;
+    bme280_osrs_t osrs_h;
+    bme280_filter_t filter;
+    bme280_t_sb_t t_sb;         /* standby between normal mode conversions */
+} bme280_profile_conf_t;
+
+static const bme280_profile_conf_t profiles[BME280_PROFILES] = {
+    [BME280_PROFILE_WEATHER] = {
+        BME280_MODE_FORCED, BME280_OSRS_X1, BME280_OSRS_X1, BME280_OSRS_X1,
+        BME280_FILTER_OFF, BME280_SB_1000
+    },
+    [BME280_PROFILE_INDOOR] = {
+        BME280_MODE_NORMAL, BME280_OSRS_X2, BME280_OSRS_X16, BME280_OSRS_X1,
+        BME280_FILTER_16, BME280_SB_1000
+    },
+    [BME280_PROFILE_HIGH_RATE] = {
+        BME280_MODE_NORMAL, BME280_OSRS_X1, BME280_OSRS_X4, BME280_OSRS_X1,
+        BME280_FILTER_16, BME280_SB_0_5
+    },
+};
+
+static i2c_t i2c_dev;
+static uint8_t i2c_addr;
+static bme280_calibration_t calib;
+static const bme280_profile_conf_t *current = &profiles[BME280_PROFILE];
+static uint32_t measure_time;   /* us, worst case of a forced conversion */
+
+/* acquisition in progress */
+static volatile uint8_t busy = 0;
+static unsigned polls;
+static bme280_burst_cb_t result_cb;
+static bme280_burst_data_t result;
+static int result_res;
+static i2c_bus_req_t step_req;
+static scheduler_job_t step_job;
+
+/* number of samples taken for @p osrs */
+static unsigned _samples(bme280_osrs_t osrs)
+{
+    return (osrs == BME280_OSRS_SKIPPED) ? 0 : 1U << (osrs - 1);
+}
+
+/* maximum measurement time, datasheet appendix 9.1 */
+static uint32_t _measure_time(const bme280_profile_conf_t *conf)
+{
+    uint32_t time = 1250 + 2300 * _samples(conf->osrs_t);
+
+    if (conf->osrs_p != BME280_OSRS_SKIPPED) {
+        time += 2300 * _samples(conf->osrs_p) + 575;
+    }
+    if (conf->osrs_h != BME280_OSRS_SKIPPED) {
+        time += 2300 * _samples(conf->osrs_h) + 575;
+    }
+    return time;
+}
+
+static uint16_t _u16(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+static int _read_calibration(void)
+{
+    uint8_t buf[BME280_CALIB_TP_LEN];
+
+    if (i2c_read_regs(i2c_dev, i2c_addr, BME280_REG_CALIB_TP, buf,
+                      BME280_CALIB_TP_LEN) != BME280_CALIB_TP_LEN) {
+        return -1;
+    }
+    calib.dig_T1 = _u16(&buf[0]);
+    calib.dig_T2 = (int16_t)_u16(&buf[2]);
+    calib.dig_T3 = (int16_t)_u16(&buf[4]);
+    calib.dig_P1 = _u16(&buf[6]);
+    calib.dig_P2 = (int16_t)_u16(&buf[8]);
+    calib.dig_P3 = (int16_t)_u16(&buf[10]);
+    calib.dig_P4 = (int16_t)_u16(&buf[12]);
+    calib.dig_P5 = (int16_t)_u16(&buf[14]);
+    calib.dig_P6 = (int16_t)_u16(&buf[16]);
+    calib.dig_P7 = (int16_t)_u16(&buf[18]);
+    calib.dig_P8 = (int16_t)_u16(&buf[20]);
+    calib.dig_P9 = (int16_t)_u16(&buf[22]);
+    calib.dig_H1 = buf[25];
+
+    if (i2c_read_regs(i2c_dev, i2c_addr, BME280_REG_CALIB_H, buf,
+                      BME280_CALIB_H_LEN) != BME280_CALIB_H_LEN) {
+        return -1;
+    }
+    /* H4 and H5 are signed 12-bit values sharing 0xE5 */
+    calib.dig_H2 = (int16_t)_u16(&buf[0]);
+    calib.dig_H3 = buf[2];
+    calib.dig_H4 = (int16_t)(((int8_t)buf[3] * 16) | (buf[4] & 0x0f));
+    calib.dig_H5 = (int16_t)(((int8_t)buf[5] * 16) | (buf[4] >> 4));
+    calib.dig_H6 = (int8_t)buf[6];
+    return 0;
+}
+
+/* compensation formulas of the datasheet, section 8.2 */
+static int32_t _t_fine(int32_t adc_t)
+{
+    int32_t var1 = ((((adc_t >> 3) - ((int32_t)calib.dig_T1 << 1))) *
+                    ((int32_t)calib.dig_T2)) >> 11;
+    int32_t var2 = (((((adc_t >> 4) - ((int32_t)calib.dig_T1)) *
+                      ((adc_t >> 4) - ((int32_t)calib.dig_T1))) >> 12) *
+                    ((int32_t)calib.dig_T3)) >> 14;
+    return var1 + var2;
+}
+
+static uint32_t _pressure(int32_t adc_p, int32_t t_fine)
+{
+    int32_t var1 = (t_fine >> 1) - 64000;
+    int32_t var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) *
+                   ((int32_t)calib.dig_P6);
+    var2 = var2 + ((var1 * ((int32_t)calib.dig_P5)) << 1);
+    var2 = (var2 >> 2) + (((int32_t)calib.dig_P4) << 16);
+    var1 = (((calib.dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) +
+            ((((int32_t)calib.dig_P2) * var1) >> 1)) >> 18;
+    var1 = (((32768 + var1)) * ((int32_t)calib.dig_P1)) >> 15;
+    if (var1 == 0) {
+        return 0;   /* avoid a division by zero */
+    }
+
+    uint32_t p = (((uint32_t)(((int32_t)1048576) - adc_p) -
+                   (var2 >> 12))) * 3125;
+    if (p < 0x80000000) {
+        p = (p << 1) / ((uint32_t)var1);
+    }
+    else {
+        p = (p / (uint32_t)var1) * 2;
+    }
+    var1 = (((int32_t)calib.dig_P9) *
+            ((int32_t)(((p >> 3) * (p >> 3)) >> 13))) >> 12;
+    var2 = (((int32_t)(p >> 2)) * ((int32_t)calib.dig_P8)) >> 13;
+    return (uint32_t)((int32_t)p + ((var1 + var2 + calib.dig_P7) >> 4));
+}
+
+/* relative humidity in Q22.10 % */
+static uint32_t _humidity(int32_t adc_h, int32_t t_fine)
+{
+    int32_t v = t_fine - ((int32_t)76800);
+
+    v = (((((adc_h << 14) - (((int32_t)calib.dig_H4) << 20) -
+            (((int32_t)calib.dig_H5) * v)) + ((int32_t)16384)) >> 15) *
+         (((((((v * ((int32_t)calib.dig_H6)) >> 10) *
+              (((v * ((int32_t)calib.dig_H3)) >> 11) + ((int32_t)32768))) >>
+             10) + ((int32_t)2097152)) * ((int32_t)calib.dig_H2) + 8192) >>
+          14));
+    v = (v - (((((v >> 15) * (v >> 15)) >> 7) *
+               ((int32_t)calib.dig_H1)) >> 4));
+    v = (v < 0) ? 0 : v;
+    v = (v > 419430400) ? 419430400 : v;
+    return (uint32_t)(v >> 12);
+}
+
+static uint8_t _ctrl_meas(bme280_mode_t mode)
+{
+    return (current->osrs_t << 5) | (current->osrs_p << 2) | mode;
+}
+
+int bme280_burst_set_profile(bme280_profile_t profile)
+{
+    const bme280_profile_conf_t *conf = &profiles[profile];
+    int res = 0;
+
+    i2c_acquire(i2c_dev);
+    /* the configuration is only taken into account in sleep mode, and
+       ctrl_hum only once ctrl_meas is written */
+    current = conf;
+    if ((i2c_write_reg(i2c_dev, i2c_addr, BME280_REG_CTRL_MEAS,
+                       _ctrl_meas(BME280_MODE_SLEEP)) < 0) ||
+        (i2c_write_reg(i2c_dev, i2c_addr, BME280_REG_CONFIG,
+                       (conf->t_sb << 5) | (conf->filter << 2)) < 0) ||
+        (i2c_write_reg(i2c_dev, i2c_addr, BME280_REG_CTRL_HUM,
+                       conf->osrs_h) < 0) ||
+        (i2c_write_reg(i2c_dev, i2c_addr, BME280_REG_CTRL_MEAS,
+                       _ctrl_meas((conf->mode == BME280_MODE_NORMAL)
+                                  ? BME280_MODE_NORMAL
+                                  : BME280_MODE_SLEEP)) < 0)) {
+        res = -1;
+    }
+    i2c_release(i2c_dev);
+
+    measure_time = _measure_time(conf);
+    if (conf->mode == BME280_MODE_NORMAL) {
+        /* let the first conversion complete */
+        xtimer_usleep(measure_time);
+    }
+    return res;
+}
+
+int bme280_burst_init(const bme280_params_t *params,
+                      bme280_profile_t profile)
+{
+    uint8_t chip_id;
+
+    i2c_dev = params->i2c_dev;
+    i2c_addr = params->i2c_addr;
+
+    i2c_acquire(i2c_dev);
+    if (i2c_init_master(i2c_dev, I2C_SPEED_NORMAL) != 0) {
+        i2c_release(i2c_dev);
+        return -1;
+    }
+    if ((i2c_read_reg(i2c_dev, i2c_addr, BME280_REG_CHIP_ID, &chip_id) != 1) ||
+        (chip_id != BME280_CHIP_ID)) {
+        i2c_release(i2c_dev);
+        return -2;
+    }
+    i2c_write_reg(i2c_dev, i2c_addr, BME280_REG_RESET, BME280_RESET_WORD);
+    i2c_release(i2c_dev);
+    xtimer_usleep(BME280_STARTUP_TIME);
+
+    i2c_acquire(i2c_dev);
+    int res = _read_calibration();
+    i2c_release(i2c_dev);
+    if (res < 0) {
+        return -2;
+    }
+    return bme280_burst_set_profile(profile);
+}
+
+/* acquisition steps, run by the bus worker: they return the time to wait
+ * before the next one, 0 once the values are read or -1 on a bus error */
+static int _trigger(void)
+{
+    if (current->mode != BME280_MODE_FORCED) {
+        /* the sensor converts on its own, its last result is ready */
+        return 0;
+    }
+
+    i2c_acquire(i2c_dev);
+    int res = i2c_write_reg(i2c_dev, i2c_addr, BME280_REG_CTRL_MEAS,
+                            _ctrl_meas(BME280_MODE_FORCED));
+    i2c_release(i2c_dev);
+    return (res < 0) ? -1 : (int)measure_time;
+}
+
+static int _collect(bme280_burst_data_t *data, unsigned poll)
+{
+    uint8_t regs[BME280_DATA_LEN];
+
+    if ((current->mode == BME280_MODE_FORCED) && (poll < BME280_POLL_MAX)) {
+        uint8_t status = 0;
+        i2c_acquire(i2c_dev);
+        int res = i2c_read_reg(i2c_dev, i2c_addr, BME280_REG_STATUS, &status);
+        i2c_release(i2c_dev);
+        if ((res == 1) && (status & BME280_STATUS_MEASURING)) {
+            return BME280_POLL_TIME;
+        }
+    }
+
+    i2c_acquire(i2c_dev);
+    int res = i2c_read_regs(i2c_dev, i2c_addr, BME280_REG_DATA, regs,
+                            BME280_DATA_LEN);
+    i2c_release(i2c_dev);
+    if (res != BME280_DATA_LEN) {
+        return -1;
+    }
+
+    int32_t adc_p = ((uint32_t)regs[0] << 12) | (regs[1] << 4) | (regs[2] >> 4);
+    int32_t adc_t = ((uint32_t)regs[3] << 12) | (regs[4] << 4) | (regs[5] >> 4);
+    int32_t adc_h = (regs[6] << 8) | regs[7];
+
+    int32_t t_fine = _t_fine(adc_t);
+    data->temperature = (t_fine * 5 + 128) >> 8;
+    data->pressure = _pressure(adc_p, t_fine);
+    data->humidity = (_humidity(adc_h, t_fine) * 100) >> 10;
+    return 0;
+}
+
+static int _op_trigger(void *arg)
+{
+    (void)arg;
+    uint32_t start = stats_now();
+    int res = _trigger();
+    stats_record(STATS_SENSOR, start);
+    return res;
+}
+
+static int _op_collect(void *arg)
+{
+    (void)arg;
+    uint32_t start = stats_now();
+    int res = _collect(&result, polls++);
+    stats_record(STATS_SENSOR, start);
+    return res;
+}
+
+/* scheduler job, hands the result over */
+static void _finish_job(void *arg)
+{
+    (void)arg;
+    bme280_burst_cb_t cb = result_cb;
+
+    busy = 0;
+    cb(&result, result_res);
+}
+
+/* scheduler job, at the end of the conversion */
+static void _collect_job(void *arg);
+
+/* run by the bus worker after each step */
+static void _step_done(i2c_bus_req_t *req)
+{
+    if (req->res > 0) {
+        scheduler_add(&step_job, _collect_job, NULL, req->res, 0);
+        return;
+    }
+    if ((req->res == 0) && (req->op == _op_trigger)) {
+        /* normal mode, nothing to wait for */
+        _collect_job(NULL);
+        return;
+    }
+    result_res = req->res;
+    scheduler_add(&step_job, _finish_job, NULL, 0, 0);
+}
+
+static void _collect_job(void *arg)
+{
+    (void)arg;
+
+    i2c_bus_req_init(&step_req, _op_collect, NULL, _step_done);
+    if (i2c_bus_submit(&step_req) < 0) {
+        result_res = -1;
+        scheduler_add(&step_job, _finish_job, NULL, 0, 0);
+    }
+}
+
+int bme280_burst_start(bme280_burst_cb_t cb)
+{
+    unsigned state = irq_disable();
+    if (busy) {
+        irq_restore(state);
+        return -EBUSY;
+    }
+    busy = 1;
+    irq_restore(state);
+
+    result_cb = cb;
+    polls = 0;
+    i2c_bus_req_init(&step_req, _op_trigger, NULL, _step_done);
+    int res = i2c_bus_submit(&step_req);
+    if (res < 0) {
+        busy = 0;
+    }
+    return res;
+}
+
+int bme280_burst_read(bme280_burst_data_t *data)
+{
+    int res = _trigger();
+
+    /* the calling thread, the bus worker for fresh reads, sleeps through
+       the conversion and holds the bus meanwhile */
+    for (unsigned poll = 0; res >= 0; poll++) {
+        if (res > 0) {
+            xtimer_usleep(res);
+        }
+        res = _collect(data, poll);
+        if (res == 0) {
+            break;
+        }
+    }
+    return res;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * BME280 acquisition in a single burst.
+ *
+ * The RIOT driver triggers a conversion and reads the measurement registers
+ * on each of its temperature, pressure and humidity calls, recomputing the
+ * temperature for the compensation of the other two. Here one acquisition
+ * triggers a forced mode conversion, reads the 8 data registers (0xF7 to
+ * 0xFE) in a single I2C transaction and compensates the three values with
+ * the 32-bit integer formulas of the datasheet, from a single t_fine.
+ *
+ * As for the BMP180, bme280_burst_start() splits an acquisition into short
+ * I2C transactions queued to the bus worker: the trigger arms a scheduler
+ * job for the end of the conversion, which queues the read, so the bus is
+ * free meanwhile. bme280_burst_read() is the blocking variant for the fresh
+ * reads: the bus worker running it sleeps through the conversion.
+ *
+ * Profiles set the oversampling, IIR filter and standby time:
+ *   weather    forced mode, x1 oversampling, no filter (datasheet 3.5.1)
+ *   indoor     normal mode every second, pressure x16, filter 16
+ *   high-rate  normal mode every 0.5 ms, pressure x4, filter 16 (3.5.4)
+ * In normal mode the sensor converts continuously and a read only fetches
+ * the last result.
+ */
+
+#ifndef BME280_BURST_H
+#define BME280_BURST_H
+
+#include <stdint.h>
+
+#include "bme280.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    BME280_PROFILE_WEATHER,
+    BME280_PROFILE_INDOOR,
+    BME280_PROFILE_HIGH_RATE,
+    BME280_PROFILES
+} bme280_profile_t;
+
+#ifndef BME280_PROFILE
+#define BME280_PROFILE          (BME280_PROFILE_WEATHER)
+#endif
+
+typedef struct {
+    int16_t temperature;    /* 0.01 °C */
+    uint32_t pressure;      /* Pa */
+    uint16_t humidity;      /* 0.01 % */
+} bme280_burst_data_t;
+
+/* Check and reset the sensor of @p params, read its calibration and apply
+ * @p profile. Returns 0 on success, -1 if the I2C bus cannot be used, -2
+ * if no BME280 answers. */
+int bme280_burst_init(const bme280_params_t *params,
+                      bme280_profile_t profile);
+
+/* Switch to @p profile. Returns 0 on success, -1 on a bus error. */
+int bme280_burst_set_profile(bme280_profile_t profile);
+
+/* Result of an acquisition, @p res is 0 or -1 on a bus error. */
+typedef void (*bme280_burst_cb_t)(const bme280_burst_data_t *data, int res);
+
+/* Start an acquisition, @p cb receiving its result on the scheduler thread.
+ * Returns 0 on success, -EBUSY if one is in progress, -ENODEV if the I2C
+ * bus worker is not running. */
+int bme280_burst_start(bme280_burst_cb_t cb);
+
+/* Convert and read all the values into @p data, sleeping through the
+ * conversion, from the I2C bus worker. Returns 0 on success, -1 on a bus
+ * error. */
+int bme280_burst_read(bme280_burst_data_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BME280_BURST_H */
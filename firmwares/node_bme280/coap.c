@@ -14,46 +14,14 @@
 #include "board.h"
 #include "periph/gpio.h"
 
-#define APPLICATION_NAME "Weather Sensor (BME280)"
+#include "telemetry.h"
+#include "sample_cache.h"
+#include "telemetry_encode.h"
+#include "resources.h"
 
-#define MAX_RESPONSE_LEN 500
-
-static uint8_t response[MAX_RESPONSE_LEN] = { 0 };
-
-static char temperature[15];
-static char pressure[15];
-static char humidity[15];
-
-extern void _send_coap_post(uint8_t* uri_path, uint8_t *data);
-
-extern void _read_temperature(int16_t * temperature);
-extern void _read_pressure(uint32_t * pressure);
-extern void _read_humidity(uint16_t * humidity);
-
-static int handle_get_well_known_core(coap_rw_buffer_t *scratch,
-                                      const coap_packet_t *inpkt,
-                                      coap_packet_t *outpkt,
-                                      uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_name(coap_rw_buffer_t *scratch,
-                           const coap_packet_t *inpkt,
-                           coap_packet_t *outpkt,
-                           uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_os(coap_rw_buffer_t *scratch,
-                         const coap_packet_t *inpkt,
-                         coap_packet_t *outpkt,
-                         uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_board(coap_rw_buffer_t *scratch,
-                            const coap_packet_t *inpkt,
-                            coap_packet_t *outpkt,
-                            uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_mcu(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo);
+extern int _read_temperature(int16_t * temperature);
+extern int _read_pressure(uint32_t * pressure);
+extern int _read_humidity(uint16_t * humidity);
 
 static int handle_get_temperature(coap_rw_buffer_t *scratch,
                                   const coap_packet_t *inpkt,
@@ -70,31 +38,6 @@ static int handle_get_humidity(coap_rw_buffer_t *scratch,
                                coap_packet_t *outpkt,
                                uint8_t id_hi, uint8_t id_lo);
 
-static int handle_get_led(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo);
-
-static int handle_put_led(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo);
-
-static const coap_endpoint_path_t path_well_known_core =
-        { 2, { ".well-known", "core" } };
-
-static const coap_endpoint_path_t path_name =
-        { 1, { "name" } };
-
-static const coap_endpoint_path_t path_os =
-        { 1, { "os" } };
-
-static const coap_endpoint_path_t path_board =
-        { 1, { "board" } };
-
-static const coap_endpoint_path_t path_mcu =
-        { 1, { "mcu" } };
-
 static const coap_endpoint_path_t path_temperature =
         { 1, { "temperature" } };
 
@@ -104,145 +47,31 @@ static const coap_endpoint_path_t path_pressure =
 static const coap_endpoint_path_t path_humidity =
         { 1, { "humidity" } };
 
-static const coap_endpoint_path_t path_led =
-        { 1, { "led" } };
-
 const coap_endpoint_t endpoints[] =
 {
-    { COAP_METHOD_GET,	handle_get_well_known_core,
-      &path_well_known_core, "ct=40" },
-    { COAP_METHOD_GET,	handle_get_name,
-      &path_name,	   "ct=0"  },
-    { COAP_METHOD_GET,	handle_get_os,
-      &path_os,  	   "ct=0"  },
-    { COAP_METHOD_GET,	handle_get_board,
-      &path_board,	   "ct=0"  },
-    { COAP_METHOD_GET,	handle_get_mcu,
-      &path_mcu,	   "ct=0"  },
+    RESOURCES_COMMON,
     { COAP_METHOD_GET,	handle_get_temperature,
-      &path_temperature,   "ct=0"  },
+      &path_temperature,   "ct=\"0 60 112\";obs"  },
     { COAP_METHOD_GET,	handle_get_pressure,
-      &path_pressure,   "ct=0"  },
+      &path_pressure,   "ct=\"0 60 112\";obs"  },
     { COAP_METHOD_GET,	handle_get_humidity,
-      &path_humidity,   "ct=0"  },
-    { COAP_METHOD_GET,	handle_get_led,
-      &path_led,	"ct=0"  },
-    { COAP_METHOD_PUT,	handle_put_led,
-      &path_led,	"ct=0"  },
-    /* marks the end of the endpoints array: */
-    { (coap_method_t)0, NULL, NULL, NULL }
+      &path_humidity,   "ct=\"0 60 112\";obs"  },
+    RESOURCES_LED,
+    RESOURCES_SAMPLING,
+    RESOURCES_REPORT,
+    RESOURCES_STATS,
+    RESOURCES_END
 };
 
 
-static int handle_get_well_known_core(coap_rw_buffer_t *scratch,
-                                      const coap_packet_t *inpkt,
-                                      coap_packet_t *outpkt,
-                                      uint8_t id_hi, uint8_t id_lo)
+static int _fresh_temperature(telemetry_reading_t *reading)
 {
-    char *rsp = (char *)response;
-    /* resetting the content of response message */
-    memset(response, 0, sizeof(response));
-    size_t len = sizeof(response);
-    const coap_endpoint_t *ep = endpoints;
-    int i;
-
-    len--; // Null-terminated string
-
-    while (NULL != ep->handler) {
-        if (NULL == ep->core_attr) {
-            ep++;
-            continue;
-        }
-
-        if (0 < strlen(rsp)) {
-            strncat(rsp, ",", len);
-            len--;
-        }
-
-        strncat(rsp, "<", len);
-        len--;
-
-        for (i = 0; i < ep->path->count; i++) {
-            strncat(rsp, "/", len);
-            len--;
-
-            strncat(rsp, ep->path->elems[i], len);
-            len -= strlen(ep->path->elems[i]);
-        }
-
-        strncat(rsp, ">;", len);
-        len -= 2;
-
-        strncat(rsp, ep->core_attr, len);
-        len -= strlen(ep->core_attr);
-
-        ep++;
+    int16_t temp;
+    if (_read_temperature(&temp) < 0) {
+        return -1;
     }
-
-    return coap_make_response(scratch, outpkt, (const uint8_t *)rsp,
-                              strlen(rsp), id_hi, id_lo, &inpkt->tok,
-                              COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_APPLICATION_LINKFORMAT);
-}
-
-static int handle_get_name(coap_rw_buffer_t *scratch,
-                           const coap_packet_t *inpkt,
-                           coap_packet_t *outpkt,
-                           uint8_t id_hi, uint8_t id_lo)
-{
-    const char *app_name = APPLICATION_NAME;
-    size_t len = strlen(APPLICATION_NAME);
-
-    memcpy(response, app_name, len);
-
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
-}
-
-static int handle_get_os(coap_rw_buffer_t *scratch,
-                         const coap_packet_t *inpkt,
-                         coap_packet_t *outpkt,
-                         uint8_t id_hi, uint8_t id_lo)
-{
-    const char *os = "riot";
-    size_t len = strlen("riot");
-
-    memcpy(response, os, len);
-
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
-}
-
-static int handle_get_board(coap_rw_buffer_t *scratch,
-                            const coap_packet_t *inpkt,
-                            coap_packet_t *outpkt,
-                            uint8_t id_hi, uint8_t id_lo)
-{
-    const char *riot_name = RIOT_BOARD;
-    size_t len = strlen(RIOT_BOARD);
-
-    memcpy(response, riot_name, len);
-
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
-}
-
-static int handle_get_mcu(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo)
-{
-    const char *riot_mcu = RIOT_MCU;
-    size_t len = strlen(RIOT_MCU);
-    
-    memcpy(response, riot_mcu, len);
-    
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
+    *reading = (telemetry_reading_t) { "temperature", "°C", temp, -2, 0 };
+    return 0;
 }
 
 static int handle_get_temperature(coap_rw_buffer_t *scratch,
@@ -250,98 +79,45 @@ static int handle_get_temperature(coap_rw_buffer_t *scratch,
                                   coap_packet_t *outpkt,
                                   uint8_t id_hi, uint8_t id_lo)
 {
-    int16_t temp;
-    memset(temperature, 0, sizeof(temperature));
-    _read_temperature(&temp);
-    sprintf(temperature, "%d.%d°C", temp / 100, (temp % 100) / 10);
-
-    memcpy(response, temperature,  strlen(temperature));
-
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, strlen(temperature),
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
+    return sample_cache_respond(scratch, inpkt, outpkt, id_hi, id_lo,
+                                "temperature", _fresh_temperature);
 }
 
-static int handle_get_pressure(coap_rw_buffer_t *scratch,
-                               const coap_packet_t *inpkt,
-                               coap_packet_t *outpkt,
-                               uint8_t id_hi, uint8_t id_lo)
+static int _fresh_pressure(telemetry_reading_t *reading)
 {
     uint32_t pres;
-    memset(pressure, 0, sizeof(pressure));
-    _read_pressure(&pres);
-    sprintf(pressure, "%lu.%dhPa",
-            (unsigned long)pres / 100, (int)pres % 100);
-
-    memcpy(response, pressure, strlen(pressure));
-
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, strlen(pressure),
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
+    if (_read_pressure(&pres) < 0) {
+        return -1;
+    }
+    /* pressure is read in Pa, report it in hPa */
+    *reading = (telemetry_reading_t) { "pressure", "hPa", pres, -2, 0 };
+    return 0;
 }
 
-static int handle_get_humidity(coap_rw_buffer_t *scratch,
+static int handle_get_pressure(coap_rw_buffer_t *scratch,
                                const coap_packet_t *inpkt,
                                coap_packet_t *outpkt,
                                uint8_t id_hi, uint8_t id_lo)
 {
-    uint16_t hum;
-    memset(humidity, 0, sizeof(humidity));
-    _read_humidity(&hum);
-    sprintf(humidity, "%u.%02u%%",
-            (unsigned int)(hum / 100),
-            (unsigned int)(hum % 100));
-
-    memcpy(response, pressure, strlen(pressure));
-
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, strlen(pressure),
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
+    return sample_cache_respond(scratch, inpkt, outpkt, id_hi, id_lo,
+                                "pressure", _fresh_pressure);
 }
 
-static int handle_get_led(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo)
+static int _fresh_humidity(telemetry_reading_t *reading)
 {
-    char led_status[1];
-    sprintf(led_status, "%d", gpio_read(LED0_PIN) == 0);
-    memcpy(response, led_status, 1);
-    
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, 1,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
+    uint16_t hum;
+    if (_read_humidity(&hum) < 0) {
+        return -1;
+    }
+    *reading = (telemetry_reading_t) { "humidity", "%", hum, -2, 0 };
+    return 0;
 }
 
-static int handle_put_led(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo)
+static int handle_get_humidity(coap_rw_buffer_t *scratch,
+                               const coap_packet_t *inpkt,
+                               coap_packet_t *outpkt,
+                               uint8_t id_hi, uint8_t id_lo)
 {
-    coap_responsecode_t resp = COAP_RSPCODE_CHANGED;
-
-    /* Check input data is valid */
-    uint8_t val = strtol((char*)inpkt->payload.p, NULL, 10);
-
-    if ((inpkt->payload.len == 1) &&
-            ((val == 1) || (val == 0))) {
-        /* update LED value */
-        gpio_write(LED0_PIN, val - 1);
-    }
-    else {
-        resp = COAP_RSPCODE_BAD_REQUEST;
-    }
-    
-    /* Reply to server */
-    int result = coap_make_response(scratch, outpkt, NULL, 0,
-                                    id_hi, id_lo,
-                                    &inpkt->tok, resp,
-                                    COAP_CONTENTTYPE_TEXT_PLAIN);
-    
-    /* Send post notification to server */
-    char led_status[5];
-    sprintf(led_status, "led:%d", gpio_read(LED0_PIN) == 0);
-    _send_coap_post((uint8_t*)"server", (uint8_t*)led_status);
-
-    return result;
+    return sample_cache_respond(scratch, inpkt, outpkt, id_hi, id_lo,
+                                "humidity", _fresh_humidity);
 }
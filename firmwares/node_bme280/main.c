@@ -15,159 +15,140 @@
 #include "xtimer.h"
 #include "bme280_params.h"
 #include "bme280.h"
+#include "bme280_burst.h"
 #include "board.h"
-#include "net/af.h"
-#include "net/gnrc/ipv6.h"
-#include "net/conn/udp.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "microcoap_conn.h"
+#include "resources.h"
+#include "telemetry_batch.h"
+#include "report.h"
+#include "observe.h"
+#include "sample_cache.h"
+#include "i2c_bus.h"
+#include "stats.h"
+
+#define APPLICATION_NAME      "Weather Sensor (BME280)"
+#define SENSORS_INTERVAL      (5000000U)     /* set temperature updates interval to 5 seconds */
 
-#ifndef BROKER_ADDR
-#define BROKER_ADDR           "2001:660:3207:102::4"
+#ifndef SENSORS_BATCH_CYCLES
+#define SENSORS_BATCH_CYCLES  (1)            /* sampling cycles pushed per batch */
 #endif
-
-#define BROKER_PORT           (5683)
-
-#define INTERVAL              (30000000U)    /* set interval to 30 seconds */
-#define SENSORS_INTERVAL      (5000000U)     /* set temperature updates interval to 5 seconds */
+#define SENSORS_BATCH_DELAY   (SENSORS_BATCH_CYCLES * SENSORS_INTERVAL)
 
 #define MAIN_QUEUE_SIZE       (8)
-#define BEACONING_QUEUE_SIZE  (8)
-#define SENSORS_QUEUE_SIZE    (8)
 static msg_t _main_msg_queue[MAIN_QUEUE_SIZE];
-static msg_t _beaconing_msg_queue[BEACONING_QUEUE_SIZE];
-static char beaconing_stack[THREAD_STACKSIZE_DEFAULT];
-
-static msg_t _sensors_msg_queue[SENSORS_QUEUE_SIZE];
-static char sensors_stack[THREAD_STACKSIZE_DEFAULT];
-
-static coap_header_t req_hdr = {
-    .ver  = 1,
-    .t    = COAP_TYPE_NONCON,
-    .tkl  = 0,
-    .code = COAP_METHOD_POST,
-    .id   = {5, 57}            // is equivalent to 1337 when converted to uint16_t
-};
 
-/* broker  */
-static const char * broker_addr = BROKER_ADDR;
-static uint16_t pkt_id = 0;
-static uint8_t response[512] = { 0 };
+static scheduler_job_t sensors_job;
+static telemetry_batch_t sensors_batch;
+static report_t sensors_report;
 
-static bme280_t bme280_dev;
-
-void microcoap_server_loop(void);
+/* deadbands of the pushed readings, in units of their last digit */
+static report_metric_t sensors_metrics[] = {
+    REPORT_METRIC("temperature", 10, 0),  /* 0.1 °C */
+    REPORT_METRIC("pressure", 10, 0),     /* 0.1 hPa */
+    REPORT_METRIC("humidity", 100, 0),    /* 1 % */
+};
 
 /* import "ifconfig" shell command, used for printing addresses */
 extern int _netif_config(int argc, char **argv);
 
-void _read_temperature(int16_t * temperature)
+/* I2C transaction of the fresh reads, run by the bus worker, which sleeps
+   through the conversion: a single burst read gives the three values */
+static int _bme280_acquire(void *arg)
 {
-    *temperature = bme280_read_temperature(&bme280_dev);
+    uint32_t start = stats_now();
+    int res = bme280_burst_read(arg);
+    stats_record(STATS_SENSOR, start);
+    return res;
 }
 
-void _read_pressure(uint32_t * pressure)
+static int _read_sensors(bme280_burst_data_t *data)
 {
-    *pressure = bme280_read_pressure(&bme280_dev);
+    int res = i2c_bus_run(_bme280_acquire, data);
+    if (res < 0) {
+        puts("Error: cannot read the BME280");
+    }
+    return res;
 }
 
-void _read_humidity(uint16_t * humidity)
+int _read_temperature(int16_t * temperature)
 {
-    *humidity = bme280_read_humidity(&bme280_dev);
+    bme280_burst_data_t data = { 0 };
+    int res = _read_sensors(&data);
+    *temperature = data.temperature;
+    return res;
 }
 
-void _send_coap_post(uint8_t* uri_path, uint8_t *data)
+int _read_pressure(uint32_t * pressure)
 {
-    /* format destination address from string */
-    ipv6_addr_t dst_addr;
-    if (ipv6_addr_from_str(&dst_addr, broker_addr) == NULL) {
-        printf("Error: address not valid '%s'\n", broker_addr);
-        return;
-    }
-
-    pkt_id ++;
-    req_hdr.id[0] = (uint8_t)(pkt_id >> 8);
-    req_hdr.id[1] = (uint8_t)(pkt_id << 8 / 255);
-
-    uint8_t  snd_buf[128];
-    size_t   req_pkt_sz;
-
-    coap_buffer_t payload = {
-        .p   = data,
-        .len = strlen((char*)data)
-    };
+    bme280_burst_data_t data = { 0 };
+    int res = _read_sensors(&data);
+    *pressure = data.pressure;
+    return res;
+}
 
-    coap_packet_t req_pkt;
-    req_pkt.hdr  = req_hdr;
-    req_pkt.tok  = (coap_buffer_t) { 0 };
-    req_pkt.numopts = 1;
-    req_pkt.opts[0].num = COAP_OPTION_URI_PATH;
-    req_pkt.opts[0].buf.p = uri_path;
-    req_pkt.opts[0].buf.len = strlen((char*)uri_path);
-    req_pkt.payload = payload;
+int _read_humidity(uint16_t * humidity)
+{
+    bme280_burst_data_t data = { 0 };
+    int res = _read_sensors(&data);
+    *humidity = data.humidity;
+    return res;
+}
 
-    req_pkt_sz = sizeof(req_pkt);
+/* end of the acquisition started by _sample_sensors(), from the scheduler
+   thread */
+static void _sensors_ready(const bme280_burst_data_t *data, int res)
+{
+    telemetry_reading_t reading;
 
-    if (coap_build(snd_buf, &req_pkt_sz, &req_pkt) != 0) {
-        printf("CoAP build failed :(\n");
+    if (res < 0) {
+        puts("Error: cannot read the BME280");
         return;
     }
 
-    conn_udp_sendto(snd_buf, req_pkt_sz, NULL, 0,
-                    &dst_addr, sizeof(dst_addr),
-                    AF_INET6, 1234, BROKER_PORT);
-}
+    reading = (telemetry_reading_t) {
+        "temperature", "°C", data->temperature, -2, sensors_job.due
+    };
+    sample_cache_put(&reading);
+    observe_notify(reading.name, &reading, 1);
+    if (report_changed(&sensors_report, &reading)) {
+        telemetry_batch_add(&sensors_batch, &reading);
+    }
 
-void *sensors_thread(void *args)
-{
-    msg_init_queue(_sensors_msg_queue, SENSORS_QUEUE_SIZE);
-
-    for(;;) {
-        /* only send temperature update when changed */
-        size_t p = 0;
-        int16_t temp = bme280_read_temperature(&bme280_dev);
-        p += sprintf((char*)&response[p], "temperature:");
-        p += sprintf((char*)&response[p], "%d.%d°C",
-                     temp / 100, (temp % 100) /10);
-        response[p] = '\0';
-        _send_coap_post((uint8_t*)"server", response);
-
-        p = 0;
-        uint32_t pres = bme280_read_pressure(&bme280_dev);
-        p += sprintf((char*)&response[p], "pressure:");
-        p += sprintf((char*)&response[p], "%lu.%dhPa",
-                     (unsigned long)pres / 100,
-                     (int)pres % 100);
-        response[p] = '\0';
-        _send_coap_post((uint8_t*)"server", response);
-
-        p = 0;
-        uint16_t hum = bme280_read_humidity(&bme280_dev);
-        p += sprintf((char*)&response[p], "humidity:");
-        p += sprintf((char*)&response[p], "%u.%02u%%",
-                     (unsigned int)(hum / 100),
-                     (unsigned int)(hum % 100));
-        response[p] = '\0';
-        _send_coap_post((uint8_t*)"server", response);
-        
-        /* wait 5 seconds */
-        xtimer_usleep(SENSORS_INTERVAL);
+    /* pressure is read in Pa, report it in hPa */
+    reading = (telemetry_reading_t) {
+        "pressure", "hPa", data->pressure, -2, sensors_job.due
+    };
+    sample_cache_put(&reading);
+    observe_notify(reading.name, &reading, 1);
+    if (report_changed(&sensors_report, &reading)) {
+        telemetry_batch_add(&sensors_batch, &reading);
     }
 
-    return NULL;
+    reading = (telemetry_reading_t) {
+        "humidity", "%", data->humidity, -2, sensors_job.due
+    };
+    sample_cache_put(&reading);
+    observe_notify(reading.name, &reading, 1);
+    if (report_changed(&sensors_report, &reading)) {
+        telemetry_batch_add(&sensors_batch, &reading);
+    }
+
+    /* push the readings once enough cycles have been collected */
+    telemetry_batch_commit(&sensors_batch);
 }
 
-void *beaconing_thread(void *args)
+/* start the conversion, the scheduler thread runs other jobs meanwhile */
+static void _sample_sensors(void *arg)
 {
-    msg_init_queue(_beaconing_msg_queue, BEACONING_QUEUE_SIZE);
+    (void)arg;
 
-    for(;;) {
-        _send_coap_post((uint8_t*)"alive", (uint8_t*)"Alive");
-        /* wait 30 seconds */
-        xtimer_usleep(INTERVAL);
+    if (bme280_burst_start(_sensors_ready) < 0) {
+        puts("Error: cannot start a BME280 acquisition");
     }
-    return NULL;
 }
 
-
 int main(void)
 {
     puts("RIOT microcoap example application");
@@ -182,9 +163,14 @@ int main(void)
     puts("Configured network interfaces:");
     _netif_config(0, NULL);
 
+    /* resolve the broker address and prepare the CoAP request headers */
+    telemetry_init();
+    resources_init(APPLICATION_NAME, &sensors_job, &sensors_report);
+    sample_cache_init(&sensors_job);
+
     /* Initialize the BME280 sensor */
     printf("+------------Initializing BME280 sensor ------------+\n");
-    uint8_t result = bme280_init(&bme280_dev, &bme280_params[0]);
+    int result = bme280_burst_init(&bme280_params[0], BME280_PROFILE);
     if (result == -1) {
         puts("[Error] The given i2c is not enabled");
     }
@@ -195,31 +181,18 @@ int main(void)
         printf("Initialization successful\n\n");
     }
 
-    /* create the beaconning thread that will send periodic messages to
-       the broker */
-    int beacon_pid = thread_create(beaconing_stack, sizeof(beaconing_stack),
-                                   THREAD_PRIORITY_MAIN - 1,
-                                   THREAD_CREATE_STACKTEST, beaconing_thread,
-                                   NULL, "Beaconing thread");
-    if (beacon_pid == -EINVAL || beacon_pid == -EOVERFLOW) {
-        puts("Error: failed to create beaconing thread, exiting\n");
-    }
-    else {
-        puts("Successfuly created beaconing thread !\n");
-    }
+    report_init(&sensors_report, sensors_metrics,
+                sizeof(sensors_metrics) / sizeof(sensors_metrics[0]));
+    telemetry_batch_init(&sensors_batch, &telemetry_server,
+                         SENSORS_BATCH_CYCLES, SENSORS_BATCH_DELAY);
 
-    /* create the sensors thread that will send periodic updates to
-       the server */
-    int sensors_pid = thread_create(sensors_stack, sizeof(sensors_stack),
-                                    THREAD_PRIORITY_MAIN - 1,
-                                    THREAD_CREATE_STACKTEST, sensors_thread,
-                                    NULL, "Sensors thread");
-    if (sensors_pid == -EINVAL || sensors_pid == -EOVERFLOW) {
-        puts("Error: failed to create sensors thread, exiting\n");
-    }
-    else {
-        puts("Successfuly created sensors thread !\n");
-    }
+    /* sensor reads from all threads go through the I2C bus worker */
+    i2c_bus_start();
+
+    /* beacon and sample the sensors from the scheduler thread */
+    telemetry_beacon_start();
+    scheduler_add(&sensors_job, _sample_sensors, NULL, 0, SENSORS_INTERVAL);
+    scheduler_start();
 
     /* start coap server loop */
     microcoap_server_loop();
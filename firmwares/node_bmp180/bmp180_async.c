@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "irq.h"
+#include "periph/i2c.h"
+#include "xtimer.h"
+
+#include "i2c_bus.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "bmp180.h"
+#include "bmp180_async.h"
+
+#define BMP180_ADDR             (0x77)
+#define BMP180_CHIP_ID          (0x55)
+
+#define BMP180_REG_CALIB        (0xAA)  /* AC1 to MD, big endian */
+#define BMP180_CALIB_LEN        (22)
+#define BMP180_REG_CHIP_ID      (0xD0)
+#define BMP180_REG_CTRL_MEAS    (0xF4)
+#define BMP180_REG_DATA         (0xF6)  /* MSB, LSB, then XLSB */
+
+#define BMP180_CMD_TEMPERATURE  (0x2E)
+#define BMP180_CMD_PRESSURE     (0x34)  /* oversampling in bits 6 and 7 */
+#define BMP180_CTRL_SCO         (0x20)  /* set until the conversion ends */
+
+#define BMP180_TEMP_TIME        (4500U)     /* us */
+#define BMP180_POLL_TIME        (1000U)     /* us */
+
+typedef enum {
+    CONV_NONE,
+    CONV_TEMPERATURE,
+    CONV_PRESSURE
+} conv_t;
+
+/* maximum pressure conversion times by oversampling setting (us) */
+static const uint32_t pressure_time[] = { 4500, 7500, 13500, 25500 };
+
+static i2c_t i2c_dev;
+static bmp180_calibration_t calib;
+static volatile uint8_t oversampling = BMP180_OVERSAMPLING;
+
+/* conversion started by the state machine, only used by the bus worker */
+static conv_t converting = CONV_NONE;
+static uint8_t conv_oversampling;
+static int32_t b5;              /* temperature term of the compensation */
+static unsigned temp_left = 0;  /* pressures left before a temperature */
+
+/* acquisition in progress */
+static volatile uint8_t busy = 0;
+static bmp180_async_cb_t result_cb;
+static bmp180_async_data_t result;
+static int result_res;
+static i2c_bus_req_t step_req;
+static scheduler_job_t step_job;
+
+static int16_t _s16(const uint8_t *buf)
+{
+    return (int16_t)((buf[0] << 8) | buf[1]);
+}
+
+static int _read_calibration(void)
+{
+    uint8_t buf[BMP180_CALIB_LEN];
+
+    if (i2c_read_regs(i2c_dev, BMP180_ADDR, BMP180_REG_CALIB, buf,
+                      BMP180_CALIB_LEN) != BMP180_CALIB_LEN) {
+        return -1;
+    }
+    calib.ac1 = _s16(&buf[0]);
+    calib.ac2 = _s16(&buf[2]);
+    calib.ac3 = _s16(&buf[4]);
+    calib.ac4 = (uint16_t)_s16(&buf[6]);
+    calib.ac5 = (uint16_t)_s16(&buf[8]);
+    calib.ac6 = (uint16_t)_s16(&buf[10]);
+    calib.b1 = _s16(&buf[12]);
+    calib.b2 = _s16(&buf[14]);
+    calib.mb = _s16(&buf[16]);
+    calib.mc = _s16(&buf[18]);
+    calib.md = _s16(&buf[20]);
+    return 0;
+}
+
+/* compensation formulas of the datasheet, section 3.5 */
+static int32_t _b5(int32_t ut)
+{
+    int32_t x1 = ((ut - (int32_t)calib.ac6) * (int32_t)calib.ac5) >> 15;
+
+    if (x1 + calib.md == 0) {
+        return x1;  /* avoid a division by zero */
+    }
+    return x1 + ((int32_t)calib.mc * 2048) / (x1 + calib.md);
+}
+
+static int32_t _pressure(int32_t up, uint8_t oss)
+{
+    int32_t b6 = b5 - 4000;
+    int32_t x1 = ((int32_t)calib.b2 * ((b6 * b6) >> 12)) >> 11;
+    int32_t x2 = ((int32_t)calib.ac2 * b6) >> 11;
+    int32_t x3 = x1 + x2;
+    int32_t b3 = ((((int32_t)calib.ac1 * 4 + x3) << oss) + 2) / 4;
+
+    x1 = ((int32_t)calib.ac3 * b6) >> 13;
+    x2 = ((int32_t)calib.b1 * ((b6 * b6) >> 12)) >> 16;
+    x3 = ((x1 + x2) + 2) >> 2;
+    uint32_t b4 = ((uint32_t)calib.ac4 * (uint32_t)(x3 + 32768)) >> 15;
+    uint32_t b7 = ((uint32_t)up - b3) * (50000 >> oss);
+    if (b4 == 0) {
+        return 0;
+    }
+
+    int32_t p = (b7 < 0x80000000) ? (b7 * 2) / b4 : (b7 / b4) * 2;
+    x1 = (p >> 8) * (p >> 8);
+    x1 = (x1 * 3038) >> 16;
+    x2 = (-7357 * p) >> 16;
+    return p + ((x1 + x2 + 3791) >> 4);
+}
+
+static int _command(uint8_t cmd)
+{
+    i2c_acquire(i2c_dev);
+    int res = i2c_write_reg(i2c_dev, BMP180_ADDR, BMP180_REG_CTRL_MEAS, cmd);
+    i2c_release(i2c_dev);
+    return (res < 0) ? -1 : 0;
+}
+
+static int _read_data(uint8_t *buf, int len)
+{
+    i2c_acquire(i2c_dev);
+    int res = i2c_read_regs(i2c_dev, BMP180_ADDR, BMP180_REG_DATA, buf, len);
+    i2c_release(i2c_dev);
+    return (res != len) ? -1 : 0;
+}
+
+static int _read_ut(int32_t *ut)
+{
+    uint8_t buf[2];
+
+    if (_read_data(buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+    *ut = (buf[0] << 8) | buf[1];
+    return 0;
+}
+
+static int _read_up(int32_t *up, uint8_t oss)
+{
+    uint8_t buf[3];
+
+    if (_read_data(buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+    *up = (((uint32_t)buf[0] << 16) | (buf[1] << 8) | buf[2]) >> (8 - oss);
+    return 0;
+}
+
+static uint8_t _pressure_cmd(uint8_t oss)
+{
+    return BMP180_CMD_PRESSURE | (oss << 6);
+}
+
+/* state machine steps, run by the bus worker: they return the time to wait
+ * before the next one, 0 once the pressure is read or -1 on a bus error */
+static int _start_temperature(void)
+{
+    converting = CONV_TEMPERATURE;
+    if (_command(BMP180_CMD_TEMPERATURE) < 0) {
+        return -1;
+    }
+    return BMP180_TEMP_TIME;
+}
+
+static int _start_pressure(void)
+{
+    converting = CONV_PRESSURE;
+    conv_oversampling = oversampling;
+    if (_command(_pressure_cmd(conv_oversampling)) < 0) {
+        return -1;
+    }
+    return pressure_time[conv_oversampling];
+}
+
+static int _collect(void)
+{
+    uint8_t ctrl;
+    int32_t raw;
+
+    i2c_acquire(i2c_dev);
+    int res = i2c_read_reg(i2c_dev, BMP180_ADDR, BMP180_REG_CTRL_MEAS, &ctrl);
+    i2c_release(i2c_dev);
+    if (res != 1) {
+        return -1;
+    }
+    if (ctrl & BMP180_CTRL_SCO) {
+        /* restarted after a blocking read, not done yet */
+        return BMP180_POLL_TIME;
+    }
+
+    if (converting == CONV_TEMPERATURE) {
+        if (_read_ut(&raw) < 0) {
+            return -1;
+        }
+        b5 = _b5(raw);
+        temp_left = BMP180_TEMP_REUSE;
+        return _start_pressure();
+    }
+
+    if (_read_up(&raw, conv_oversampling) < 0) {
+        return -1;
+    }
+    result.temperature = (b5 + 8) >> 4;
+    result.pressure = _pressure(raw, conv_oversampling);
+    temp_left--;
+    converting = CONV_NONE;
+    return 0;
+}
+
+static int _op_start(void *arg)
+{
+    (void)arg;
+    uint32_t start = stats_now();
+    int res = (temp_left == 0) ? _start_temperature() : _start_pressure();
+    stats_record(STATS_SENSOR, start);
+    return res;
+}
+
+static int _op_collect(void *arg)
+{
+    (void)arg;
+    uint32_t start = stats_now();
+    int res = _collect();
+    stats_record(STATS_SENSOR, start);
+    return res;
+}
+
+/* scheduler job, hands the result over */
+static void _finish_job(void *arg)
+{
+    (void)arg;
+    bmp180_async_cb_t cb = result_cb;
+
+    busy = 0;
+    cb(&result, result_res);
+}
+
+/* scheduler job, at the end of a conversion */
+static void _collect_job(void *arg);
+
+/* run by the bus worker after each step */
+static void _step_done(i2c_bus_req_t *req)
+{
+    if (req->res > 0) {
+        scheduler_add(&step_job, _collect_job, NULL, req->res, 0);
+        return;
+    }
+    if (req->res < 0) {
+        converting = CONV_NONE;
+    }
+    result_res = req->res;
+    scheduler_add(&step_job, _finish_job, NULL, 0, 0);
+}
+
+static void _collect_job(void *arg)
+{
+    (void)arg;
+
+    i2c_bus_req_init(&step_req, _op_collect, NULL, _step_done);
+    if (i2c_bus_submit(&step_req) < 0) {
+        result_res = -1;
+        _finish_job(NULL);
+    }
+}
+
+int bmp180_async_init(i2c_t dev, uint8_t oss)
+{
+    uint8_t chip_id;
+
+    /* like the driver, fall back to ultra low power on a bad setting */
+    oversampling = (oss > BMP180_OVERSAMPLING_MAX) ? 0 : oss;
+    i2c_dev = dev;
+
+    i2c_acquire(i2c_dev);
+    if (i2c_init_master(i2c_dev, I2C_SPEED_NORMAL) != 0) {
+        i2c_release(i2c_dev);
+        return -1;
+    }
+    if ((i2c_read_reg(i2c_dev, BMP180_ADDR, BMP180_REG_CHIP_ID,
+                      &chip_id) != 1) ||
+        (chip_id != BMP180_CHIP_ID) || (_read_calibration() < 0)) {
+        i2c_release(i2c_dev);
+        return -2;
+    }
+    i2c_release(i2c_dev);
+    return 0;
+}
+
+int bmp180_async_set_oversampling(uint8_t oss)
+{
+    if (oss > BMP180_OVERSAMPLING_MAX) {
+        return -EINVAL;
+    }
+    oversampling = oss;
+    return 0;
+}
+
+uint8_t bmp180_async_oversampling(void)
+{
+    return oversampling;
+}
+
+int bmp180_async_start(bmp180_async_cb_t cb)
+{
+    unsigned state = irq_disable();
+    if (busy) {
+        irq_restore(state);
+        return -EBUSY;
+    }
+    busy = 1;
+    irq_restore(state);
+
+    result_cb = cb;
+    i2c_bus_req_init(&step_req, _op_start, NULL, _step_done);
+    int res = i2c_bus_submit(&step_req);
+    if (res < 0) {
+        busy = 0;
+    }
+    return res;
+}
+
+int bmp180_async_read(bmp180_async_data_t *data)
+{
+    uint8_t oss = oversampling;
+    int32_t raw;
+
+    if (_command(BMP180_CMD_TEMPERATURE) < 0) {
+        return -1;
+    }
+    xtimer_usleep(BMP180_TEMP_TIME);
+    if (_read_ut(&raw) < 0) {
+        return -1;
+    }
+    b5 = _b5(raw);
+    temp_left = BMP180_TEMP_REUSE;
+
+    if (_command(_pressure_cmd(oss)) < 0) {
+        return -1;
+    }
+    xtimer_usleep(pressure_time[oss]);
+    if (_read_up(&raw, oss) < 0) {
+        return -1;
+    }
+    data->temperature = (b5 + 8) >> 4;
+    data->pressure = _pressure(raw, oss);
+
+    /* the conversion of an acquisition in progress got overwritten, start
+       it again, its next step waits for it */
+    if (converting == CONV_TEMPERATURE) {
+        _command(BMP180_CMD_TEMPERATURE);
+    }
+    else if (converting == CONV_PRESSURE) {
+        _command(_pressure_cmd(conv_oversampling));
+    }
+    return 0;
+}
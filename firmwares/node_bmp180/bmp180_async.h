@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Non-blocking BMP180 conversions.
+ *
+ * The RIOT driver sleeps through each conversion (4.5 ms for the
+ * temperature, up to 25.5 ms for the pressure in ultra high resolution) in
+ * the thread reading the sensor, and converts the temperature again before
+ * each pressure. Here an acquisition is a state machine: each step is a
+ * short I2C transaction queued to the bus worker, which starts a conversion
+ * and arms a scheduler job for its end, so no thread waits for the sensor.
+ * The result is handed to a callback run by the scheduler thread.
+ *
+ * The temperature only compensates the pressure and moves slowly, so one
+ * temperature conversion serves BMP180_TEMP_REUSE pressure conversions. The
+ * oversampling setting can be changed at any time and applies from the next
+ * pressure conversion.
+ */
+
+#ifndef BMP180_ASYNC_H
+#define BMP180_ASYNC_H
+
+#include <stdint.h>
+
+#include "periph/i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BMP180_OVERSAMPLING
+#define BMP180_OVERSAMPLING     (0)     /* ultra low power */
+#endif
+
+#ifndef BMP180_TEMP_REUSE
+#define BMP180_TEMP_REUSE       (4)     /* pressures per temperature, >= 1 */
+#endif
+
+#define BMP180_OVERSAMPLING_MAX (3)     /* ultra high resolution */
+
+typedef struct {
+    int32_t temperature;    /* 0.1 °C */
+    int32_t pressure;       /* Pa */
+} bmp180_async_data_t;
+
+/* Result of an acquisition, @p res is 0 or -1 on a bus error. */
+typedef void (*bmp180_async_cb_t)(const bmp180_async_data_t *data, int res);
+
+/* Check the sensor on @p dev and read its calibration. Returns 0 on
+ * success, -1 if the I2C bus cannot be used, -2 if no BMP180 answers. */
+int bmp180_async_init(i2c_t dev, uint8_t oversampling);
+
+/* Use @p oversampling (0 to 3) for the next pressure conversions. Returns 0
+ * on success, -EINVAL if it is out of range. */
+int bmp180_async_set_oversampling(uint8_t oversampling);
+
+/* Current oversampling setting. */
+uint8_t bmp180_async_oversampling(void);
+
+/* Start an acquisition, @p cb receiving its result. Returns 0 on success,
+ * -EBUSY if one is in progress, -ENODEV if the I2C bus worker is not
+ * running. */
+int bmp180_async_start(bmp180_async_cb_t cb);
+
+/* Convert the temperature and the pressure into @p data, sleeping through
+ * the conversions, from the I2C bus worker. Returns 0 on success, -1 on a
+ * bus error. */
+int bmp180_async_read(bmp180_async_data_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BMP180_ASYNC_H */
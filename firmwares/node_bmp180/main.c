@@ -11,155 +11,130 @@
 #include "msg.h"
 #include "thread.h"
 #include "xtimer.h"
-#include "bmp180.h"
+#include "bmp180_async.h"
 #include "board.h"
-#include "net/af.h"
-#include "net/gnrc/ipv6.h"
-#include "net/conn/udp.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "microcoap_conn.h"
+#include "resources.h"
+#include "telemetry_batch.h"
+#include "fixed.h"
+#include "report.h"
+#include "observe.h"
+#include "sample_cache.h"
+#include "i2c_bus.h"
+#include "stats.h"
+
+#define APPLICATION_NAME      "Weather Sensor"
+#define SENSORS_INTERVAL      (5000000U)     /* set temperature updates interval to 5 seconds */
 
-#ifndef BROKER_ADDR
-#define BROKER_ADDR           "2001:660:3207:102::4"
+#ifndef SENSORS_BATCH_CYCLES
+#define SENSORS_BATCH_CYCLES  (1)            /* sampling cycles pushed per batch */
 #endif
-
-#define BROKER_PORT           (5683)
-
-#define INTERVAL              (30000000U)    /* set interval to 30 seconds */
-#define SENSORS_INTERVAL      (5000000U)     /* set temperature updates interval to 5 seconds */
+#define SENSORS_BATCH_DELAY   (SENSORS_BATCH_CYCLES * SENSORS_INTERVAL)
 
 #define MAIN_QUEUE_SIZE       (8)
-#define BEACONING_QUEUE_SIZE  (8)
-#define SENSORS_QUEUE_SIZE    (8)
 static msg_t _main_msg_queue[MAIN_QUEUE_SIZE];
-static msg_t _beaconing_msg_queue[BEACONING_QUEUE_SIZE];
-static char beaconing_stack[THREAD_STACKSIZE_DEFAULT];
-
-static msg_t _sensors_msg_queue[SENSORS_QUEUE_SIZE];
-static char sensors_stack[THREAD_STACKSIZE_DEFAULT];
-
-static coap_header_t req_hdr = {
-    .ver  = 1,
-    .t    = COAP_TYPE_NONCON,
-    .tkl  = 0,
-    .code = COAP_METHOD_POST,
-    .id   = {5, 57}            // is equivalent to 1337 when converted to uint16_t
-};
 
-/* broker  */
-static const char * broker_addr = BROKER_ADDR;
-static uint16_t pkt_id = 0;
-static uint8_t response[512] = { 0 };
+static scheduler_job_t sensors_job;
+static telemetry_batch_t sensors_batch;
+static report_t sensors_report;
+
+/* deadbands of the pushed readings, in units of their last digit */
+static report_metric_t sensors_metrics[] = {
+    REPORT_METRIC("temperature", 1, 0),   /* 0.1 °C */
+    REPORT_METRIC("pressure", 10, 0),     /* 0.1 hPa */
+};
 
 /* BMP180 sensor */
 #define I2C_DEVICE (0)
-static bmp180_t bmp180_dev;
-static int32_t s_temperature = 0;
-static int32_t s_pressure = 0;
-
-void microcoap_server_loop(void);
 
 /* import "ifconfig" shell command, used for printing addresses */
 extern int _netif_config(int argc, char **argv);
 
-void _read_temperature(int32_t * temperature)
+/* I2C transaction of the fresh reads, run by the bus worker, which sleeps
+   through the conversions */
+static int _bmp180_read(void *arg)
 {
-    bmp180_read_temperature(&bmp180_dev, temperature);
+    uint32_t start = stats_now();
+    int res = bmp180_async_read(arg);
+    stats_record(STATS_SENSOR, start);
+    return res;
 }
 
-void _read_pressure(int32_t * pressure)
+static int _read_sensors(bmp180_async_data_t *data)
 {
-    bmp180_read_pressure(&bmp180_dev, pressure);
+    int res = i2c_bus_run(_bmp180_read, data);
+    if (res < 0) {
+        puts("Error: cannot read the BMP180");
+    }
+    return res;
 }
 
-void _send_coap_post(uint8_t* uri_path, uint8_t *data)
+int _read_temperature(int32_t * temperature)
 {
-    /* format destination address from string */
-    ipv6_addr_t dst_addr;
-    if (ipv6_addr_from_str(&dst_addr, broker_addr) == NULL) {
-        printf("Error: address not valid '%s'\n", broker_addr);
-        return;
-    }
-
-    pkt_id ++;
-    req_hdr.id[0] = (uint8_t)(pkt_id >> 8);
-    req_hdr.id[1] = (uint8_t)(pkt_id << 8 / 255);
-
-    uint8_t  snd_buf[128];
-    size_t   req_pkt_sz;
-
-    coap_buffer_t payload = {
-        .p   = data,
-        .len = strlen((char*)data)
-    };
+    bmp180_async_data_t data = { 0 };
+    int res = _read_sensors(&data);
+    *temperature = data.temperature;
+    return res;
+}
 
-    coap_packet_t req_pkt;
-    req_pkt.hdr  = req_hdr;
-    req_pkt.tok  = (coap_buffer_t) { 0 };
-    req_pkt.numopts = 1;
-    req_pkt.opts[0].num = COAP_OPTION_URI_PATH;
-    req_pkt.opts[0].buf.p = uri_path;
-    req_pkt.opts[0].buf.len = strlen((char*)uri_path);
-    req_pkt.payload = payload;
+int _read_pressure(int32_t * pressure)
+{
+    bmp180_async_data_t data = { 0 };
+    int res = _read_sensors(&data);
+    *pressure = data.pressure;
+    return res;
+}
 
-    req_pkt_sz = sizeof(req_pkt);
+/* end of the acquisition started by _sample_sensors(), from the scheduler
+   thread */
+static void _sensors_ready(const bmp180_async_data_t *data, int res)
+{
+    telemetry_reading_t reading;
 
-    if (coap_build(snd_buf, &req_pkt_sz, &req_pkt) != 0) {
-        printf("CoAP build failed :(\n");
+    if (res < 0) {
+        puts("Error: cannot read the BMP180");
         return;
     }
 
-    conn_udp_sendto(snd_buf, req_pkt_sz, NULL, 0,
-                    &dst_addr, sizeof(dst_addr),
-                    AF_INET6, 1234, BROKER_PORT);
-}
+    reading = (telemetry_reading_t) {
+        "temperature", "°C", data->temperature, -1,
+        sensors_job.due
+    };
+    sample_cache_put(&reading);
+    observe_notify(reading.name, &reading, 1);
+    /* only push readings that moved beyond their deadband */
+    if (report_changed(&sensors_report, &reading)) {
+        telemetry_batch_add(&sensors_batch, &reading);
+    }
 
-void *sensors_thread(void *args)
-{
-    msg_init_queue(_sensors_msg_queue, SENSORS_QUEUE_SIZE);
-    int32_t tmp_temperature, tmp_pressure;
-
-    for(;;) {
-        bmp180_read_temperature(&bmp180_dev, &tmp_temperature);
-        /* only send temperature update when changed */
-        size_t p = 0;
-        if (tmp_temperature != s_temperature) {
-            p += sprintf((char*)&response[p], "temperature:");
-            p += sprintf((char*)&response[p],
-                         "%.1f°C", (double)tmp_temperature/10.0);
-            response[p] = '\0';
-            _send_coap_post((uint8_t*)"server", response);
-            s_temperature = tmp_temperature;
-        }
-
-        bmp180_read_pressure(&bmp180_dev, &tmp_pressure);
-        if (tmp_pressure != s_pressure) {
-            p = 0;
-            p += sprintf((char*)&response[p], "pressure:");
-            p += sprintf((char*)&response[p], "%.2fhPa", (double)tmp_pressure/100.0);
-            response[p] = '\0';
-            _send_coap_post((uint8_t*)"server", response);
-            s_pressure = tmp_pressure;
-        }
-
-        /* wait 5 seconds */
-        xtimer_usleep(SENSORS_INTERVAL);
+    /* pressure is read in Pa, report it in hPa */
+    reading = (telemetry_reading_t) {
+        "pressure", "hPa",
+        fixed_convert(data->pressure, &fixed_bmp180_pressure),
+        fixed_bmp180_pressure.scale, sensors_job.due
+    };
+    sample_cache_put(&reading);
+    observe_notify(reading.name, &reading, 1);
+    if (report_changed(&sensors_report, &reading)) {
+        telemetry_batch_add(&sensors_batch, &reading);
     }
 
-    return NULL;
+    /* push the readings once enough cycles have been collected */
+    telemetry_batch_commit(&sensors_batch);
 }
 
-void *beaconing_thread(void *args)
+/* start the conversions, the scheduler thread runs other jobs meanwhile */
+static void _sample_sensors(void *arg)
 {
-    msg_init_queue(_beaconing_msg_queue, BEACONING_QUEUE_SIZE);
+    (void)arg;
 
-    for(;;) {
-        _send_coap_post((uint8_t*)"alive", (uint8_t*)"Alive");
-        /* wait 30 seconds */
-        xtimer_usleep(INTERVAL);
+    if (bmp180_async_start(_sensors_ready) < 0) {
+        puts("Error: cannot start a BMP180 acquisition");
     }
-    return NULL;
 }
 
-
 int main(void)
 {
     puts("RIOT microcoap example application");
@@ -174,9 +149,14 @@ int main(void)
     puts("Configured network interfaces:");
     _netif_config(0, NULL);
 
+    /* resolve the broker address and prepare the CoAP request headers */
+    telemetry_init();
+    resources_init(APPLICATION_NAME, &sensors_job, &sensors_report);
+    sample_cache_init(&sensors_job);
+
     /* Initialize the BMP180 sensor */
     printf("+------------Initializing BMP180 sensor ------------+\n");
-    uint8_t result = bmp180_init(&bmp180_dev, I2C_DEVICE, BMP180_ULTRALOWPOWER);
+    int result = bmp180_async_init(I2C_DEVICE, BMP180_OVERSAMPLING);
     if (result == -1) {
         puts("[Error] The given i2c is not enabled");
     }
@@ -187,31 +167,18 @@ int main(void)
         printf("Initialization successful\n\n");
     }
 
-    /* create the beaconning thread that will send periodic messages to
-       the broker */
-    int beacon_pid = thread_create(beaconing_stack, sizeof(beaconing_stack),
-                                   THREAD_PRIORITY_MAIN - 1,
-                                   THREAD_CREATE_STACKTEST, beaconing_thread,
-                                   NULL, "Beaconing thread");
-    if (beacon_pid == -EINVAL || beacon_pid == -EOVERFLOW) {
-        puts("Error: failed to create beaconing thread, exiting\n");
-    }
-    else {
-        puts("Successfuly created beaconing thread !\n");
-    }
+    report_init(&sensors_report, sensors_metrics,
+                sizeof(sensors_metrics) / sizeof(sensors_metrics[0]));
+    telemetry_batch_init(&sensors_batch, &telemetry_server,
+                         SENSORS_BATCH_CYCLES, SENSORS_BATCH_DELAY);
 
-    /* create the sensors thread that will send periodic updates to
-       the server */
-    int sensors_pid = thread_create(sensors_stack, sizeof(sensors_stack),
-                                    THREAD_PRIORITY_MAIN - 1,
-                                    THREAD_CREATE_STACKTEST, sensors_thread,
-                                    NULL, "Sensors thread");
-    if (sensors_pid == -EINVAL || sensors_pid == -EOVERFLOW) {
-        puts("Error: failed to create sensors thread, exiting\n");
-    }
-    else {
-        puts("Successfuly created sensors thread !\n");
-    }
+    /* sensor reads from all threads go through the I2C bus worker */
+    i2c_bus_start();
+
+    /* beacon and sample the sensors from the scheduler thread */
+    telemetry_beacon_start();
+    scheduler_add(&sensors_job, _sample_sensors, NULL, 0, SENSORS_INTERVAL);
+    scheduler_start();
 
     /* start coap server loop */
     microcoap_server_loop();
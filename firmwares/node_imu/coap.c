@@ -6,274 +6,219 @@
  * directory for more details.
  */
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <coap.h>
 
 #include "board.h"
 #include "periph/gpio.h"
-
-#define APPLICATION_NAME "IMU Unit"
-
-#define MAX_RESPONSE_LEN 500
-static uint8_t response[MAX_RESPONSE_LEN] = { 0 };
-
-static char payload[512];
-
-extern void _read_imu(char* payload);
-extern void _send_coap_post(uint8_t* uri_path, uint8_t *data);
-
-static int handle_get_well_known_core(coap_rw_buffer_t *scratch,
-                                      const coap_packet_t *inpkt,
-                                      coap_packet_t *outpkt,
-                                      uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_name(coap_rw_buffer_t *scratch,
-                           const coap_packet_t *inpkt,
-                           coap_packet_t *outpkt,
-                           uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_os(coap_rw_buffer_t *scratch,
-                         const coap_packet_t *inpkt,
-                         coap_packet_t *outpkt,
-                         uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_board(coap_rw_buffer_t *scratch,
-                            const coap_packet_t *inpkt,
-                            coap_packet_t *outpkt,
-                            uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_mcu(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo);
-
-static int handle_get_led(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo);
-
-static int handle_put_led(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo);
+#include "xtimer.h"
+
+#include "telemetry.h"
+#include "telemetry_encode.h"
+#include "observe.h"
+#include "block.h"
+#include "coap_msg.h"
+#include "imu_burst.h"
+#include "microcoap_conn.h"
+#include "resources.h"
+#include "response.h"
+
+/* a client fetching a burst batch that asks for no block during this time
+   gave up, its batch is replaced by the next one */
+#ifndef IMU_BURST_HOLD
+#define IMU_BURST_HOLD  (10000000U)     /* 10 seconds */
+#endif
+
+/* burst batch being served, kept for the client that asked for its first
+   block until that client got its last block, with the ETag telling the
+   batches apart */
+static uint8_t burst_batch[IMU_BURST_BATCH_LEN];
+static size_t burst_batch_len = 0;
+static uint8_t burst_batch_sent = 1;
+static uint8_t burst_etag = 0;
+static uint8_t burst_addr[16];
+static size_t burst_addr_len = 0;
+static uint16_t burst_port;
+static uint32_t burst_time;             /* last block asked by the client */
+static const uint8_t burst_max_age = IMU_BURST_HOLD / 1000000U;
+
+#define IMU_READINGS (9)
+
+#define COAP_RSPCODE_SERVICE_UNAVAILABLE MAKE_RSPCODE(5, 3)
+
+extern int _read_imu(char* payload);
+extern int _read_imu_readings(telemetry_reading_t *readings);
 
 static int handle_get_imu(coap_rw_buffer_t *scratch,
                           const coap_packet_t *inpkt,
                           coap_packet_t *outpkt,
                           uint8_t id_hi, uint8_t id_lo);
 
-static const coap_endpoint_path_t path_well_known_core =
-        { 2, { ".well-known", "core" } };
-
-static const coap_endpoint_path_t path_name =
-        { 1, { "name" } };
-
-static const coap_endpoint_path_t path_os =
-        { 1, { "os" } };
-
-static const coap_endpoint_path_t path_board =
-        { 1, { "board" } };
-
-static const coap_endpoint_path_t path_mcu =
-        { 1, { "mcu" } };
+static int handle_get_imu_burst(coap_rw_buffer_t *scratch,
+                                const coap_packet_t *inpkt,
+                                coap_packet_t *outpkt,
+                                uint8_t id_hi, uint8_t id_lo);
 
-static const coap_endpoint_path_t path_led =
-        { 1, { "led" } };
+static int handle_put_imu_burst(coap_rw_buffer_t *scratch,
+                                const coap_packet_t *inpkt,
+                                coap_packet_t *outpkt,
+                                uint8_t id_hi, uint8_t id_lo);
 
 static const coap_endpoint_path_t path_imu =
         { 1, { "imu" } };
 
+static const coap_endpoint_path_t path_imu_burst =
+        { 2, { "imu", "burst" } };
+
 const coap_endpoint_t endpoints[] =
 {
-    { COAP_METHOD_GET,	handle_get_well_known_core,
-      &path_well_known_core, "ct=40" },
-    { COAP_METHOD_GET,	handle_get_name,
-      &path_name,	   "ct=0"  },
-    { COAP_METHOD_GET,	handle_get_os,
-      &path_os,  	   "ct=0"  },
-    { COAP_METHOD_GET,	handle_get_board,
-      &path_board,	   "ct=0"  },
-    { COAP_METHOD_GET,	handle_get_mcu,
-      &path_mcu,	   "ct=0"  },
-    { COAP_METHOD_GET,	handle_get_led,
-      &path_led,	   "ct=0"  },
-    { COAP_METHOD_PUT,	handle_put_led,
-      &path_led,	   "ct=0"  },
+    RESOURCES_COMMON,
+    RESOURCES_LED,
     { COAP_METHOD_GET,	handle_get_imu,
-      &path_imu,	   "ct=0"  },
-    /* marks the end of the endpoints array: */
-    { (coap_method_t)0, NULL, NULL, NULL }
+      &path_imu,	   "ct=\"0 60 112\";obs"  },
+    { COAP_METHOD_GET,	handle_get_imu_burst,
+      &path_imu_burst,	   "ct=42"  },
+    { COAP_METHOD_PUT,	handle_put_imu_burst,
+      &path_imu_burst,	   "ct=0"  },
+    RESOURCES_SAMPLING,
+    RESOURCES_STATS,
+    RESOURCES_END
 };
 
-static int handle_get_well_known_core(coap_rw_buffer_t *scratch,
-        const coap_packet_t *inpkt, coap_packet_t *outpkt,
-        uint8_t id_hi, uint8_t id_lo)
-{
-    char *rsp = (char *)response;
-    /* resetting the content of response message */
-    memset(response, 0, sizeof(response));
-    size_t len = sizeof(response);
-    const coap_endpoint_t *ep = endpoints;
-    int i;
-
-    len--; // Null-terminated string
-
-    while (NULL != ep->handler) {
-        if (NULL == ep->core_attr) {
-            ep++;
-            continue;
-        }
-
-        if (0 < strlen(rsp)) {
-            strncat(rsp, ",", len);
-            len--;
-        }
-
-        strncat(rsp, "<", len);
-        len--;
 
-        for (i = 0; i < ep->path->count; i++) {
-            strncat(rsp, "/", len);
-            len--;
-
-            strncat(rsp, ep->path->elems[i], len);
-            len -= strlen(ep->path->elems[i]);
+static int handle_get_imu(coap_rw_buffer_t *scratch,
+                          const coap_packet_t *inpkt,
+                          coap_packet_t *outpkt,
+                          uint8_t id_hi, uint8_t id_lo)
+{
+    uint8_t count;
+
+    /* plain text GETs keep the JSON document, observers and binary
+       formats get one reading per axis */
+    if ((telemetry_accept_format(inpkt) != TELEMETRY_FORMAT_TEXT) ||
+        (coap_findOptions(inpkt, COAP_OPTION_OBSERVE, &count) != NULL)) {
+        telemetry_reading_t readings[IMU_READINGS];
+        if (_read_imu_readings(readings) < 0) {
+            return coap_make_response(scratch, outpkt, NULL, 0,
+                                      id_hi, id_lo, &inpkt->tok,
+                                      COAP_RSPCODE_INTERNAL_ERROR,
+                                      COAP_CONTENTTYPE_TEXT_PLAIN);
         }
 
-        strncat(rsp, ">;", len);
-        len -= 2;
-
-        strncat(rsp, ep->core_attr, len);
-        len -= strlen(ep->core_attr);
-
-        ep++;
+        return observe_make_response(scratch, inpkt, outpkt, id_hi, id_lo,
+                                     "imu", readings, IMU_READINGS);
     }
 
-    return coap_make_response(scratch, outpkt, (const uint8_t *)rsp,
-                              strlen(rsp), id_hi, id_lo, &inpkt->tok,
-                              COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_APPLICATION_LINKFORMAT);
-}
-
-static int handle_get_name(coap_rw_buffer_t *scratch,
-                           const coap_packet_t *inpkt,
-                           coap_packet_t *outpkt,
-                           uint8_t id_hi, uint8_t id_lo)
-{
-    const char *app_name = APPLICATION_NAME;
-    size_t len = strlen(APPLICATION_NAME);
-
-    memcpy(response, app_name, len);
-
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
-}
-
-static int handle_get_os(coap_rw_buffer_t *scratch,
-                         const coap_packet_t *inpkt,
-                         coap_packet_t *outpkt,
-                         uint8_t id_hi, uint8_t id_lo)
-{
-    const char *os = "riot";
-    size_t len = strlen("riot");
+    /* format the JSON document right where the response is built */
+    char *payload = (char *)response_payload();
+    if (_read_imu(payload) < 0) {
+        return coap_make_response(scratch, outpkt, NULL, 0,
+                                  id_hi, id_lo, &inpkt->tok,
+                                  COAP_RSPCODE_INTERNAL_ERROR,
+                                  COAP_CONTENTTYPE_TEXT_PLAIN);
+    }
 
-    memcpy(response, os, len);
+    int len = strlen(payload);
 
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
+    return coap_make_response(scratch, outpkt, (const uint8_t *)payload, len,
                               id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
                               COAP_CONTENTTYPE_TEXT_PLAIN);
 }
 
-static int handle_get_board(coap_rw_buffer_t *scratch,
-                            const coap_packet_t *inpkt,
-                            coap_packet_t *outpkt,
-                            uint8_t id_hi, uint8_t id_lo)
+static int handle_get_imu_burst(coap_rw_buffer_t *scratch,
+                                const coap_packet_t *inpkt,
+                                coap_packet_t *outpkt,
+                                uint8_t id_hi, uint8_t id_lo)
 {
-    const char *riot_name = RIOT_BOARD;
-    size_t len = strlen(RIOT_BOARD);
+    block_opt_t block = { 0, 0, BLOCK_SZX };
+    uint8_t addr[16];
+    size_t addr_len;
+    uint16_t port;
+    uint32_t now = xtimer_now_usec();
+
+    block_get(inpkt, COAP_OPTION_BLOCK2, &block);
+    microcoap_remote(addr, &addr_len, &port);
+    int owner = (addr_len == burst_addr_len) && (port == burst_port) &&
+                (memcmp(addr, burst_addr, addr_len) == 0);
+
+    /* a new transfer drains the next batch once the last one was sent
+       whole or given up, a repeated or restarted one of the same client
+       gets the same batch again, other clients wait */
+    if (block.num == 0) {
+        if (burst_batch_sent || (now - burst_time >= IMU_BURST_HOLD)) {
+            burst_batch_len = imu_burst_drain(burst_batch);
+            burst_batch_sent = 0;
+            burst_etag++;
+            memcpy(burst_addr, addr, addr_len);
+            burst_addr_len = addr_len;
+            burst_port = port;
+            owner = 1;
+        }
+        else if (!owner) {
+            int res = coap_msg_reply(scratch, inpkt, outpkt,
+                                     COAP_RSPCODE_SERVICE_UNAVAILABLE);
+            coap_msg_add_option(outpkt, COAP_OPTION_MAX_AGE, &burst_max_age,
+                                sizeof(burst_max_age));
+            return res;
+        }
+    }
 
-    memcpy(response, riot_name, len);
+    /* end of the block served, which block_apply() caps to BLOCK_SZX */
+    if (owner && !burst_batch_sent) {
+        uint8_t szx = (block.szx > BLOCK_SZX) ? BLOCK_SZX : block.szx;
+        size_t end = block.num * BLOCK_SIZE(block.szx) + BLOCK_SIZE(szx);
+        burst_time = now;
+        if (end >= burst_batch_len) {
+            burst_batch_sent = 1;
+        }
+    }
 
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
-}
+    int res = coap_make_response(scratch, outpkt, burst_batch,
+                                 burst_batch_len, id_hi, id_lo, &inpkt->tok,
+                                 COAP_RSPCODE_CONTENT,
+                                 (coap_content_type_t)IMU_BURST_FORMAT);
 
-static int handle_get_mcu(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo)
-{
-    const char *riot_mcu = RIOT_MCU;
-    size_t len = strlen(RIOT_MCU);
-    
-    memcpy(response, riot_mcu, len);
-    
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
-}
-
-static int handle_get_led(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo)
-{
-    char led_status[1];
-    sprintf(led_status, "%d", gpio_read(LED0_PIN) == 0);
-    memcpy(response, led_status, 1);
-    
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, 1,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
+    if (res == 0) {
+        coap_msg_add_option(outpkt, COAP_OPTION_ETAG, &burst_etag,
+                            sizeof(burst_etag));
+    }
+    return res;
 }
 
-static int handle_put_led(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo)
+static int handle_put_imu_burst(coap_rw_buffer_t *scratch,
+                                const coap_packet_t *inpkt,
+                                coap_packet_t *outpkt,
+                                uint8_t id_hi, uint8_t id_lo)
 {
     coap_responsecode_t resp = COAP_RSPCODE_CHANGED;
-  
-    /* Check input data is valid */
-    uint8_t val = strtol((char*)inpkt->payload.p, NULL, 10);
-    if ((inpkt->payload.len == 1) &&
-            ((val == 1) || (val == 0))) {
-        /* update LED value */
-        gpio_write(LED0_PIN, 1 - val);
-    }
-    else {
+    char args[16];
+    char *end;
+
+    /* payload: "<rate in Hz> [<number of samples>]" */
+    if (inpkt->payload.len >= sizeof(args)) {
         resp = COAP_RSPCODE_BAD_REQUEST;
     }
-    
-    /* Reply to server */
-    int result = coap_make_response(scratch, outpkt, NULL, 0,
-                                    id_hi, id_lo,
-                                    &inpkt->tok, resp,
-                                    COAP_CONTENTTYPE_TEXT_PLAIN);
-    
-    /* Send post notification to server */
-    char led_status[5];
-    sprintf(led_status, "led:%d", gpio_read(LED0_PIN) == 0);
-    _send_coap_post((uint8_t*)"server", (uint8_t*)led_status);
-    
-    return result;
-}
-
+    else {
+        memcpy(args, inpkt->payload.p, inpkt->payload.len);
+        args[inpkt->payload.len] = '\0';
 
-static int handle_get_imu(coap_rw_buffer_t *scratch,
-                          const coap_packet_t *inpkt,
-                          coap_packet_t *outpkt,
-                          uint8_t id_hi, uint8_t id_lo)
-{    
-    _read_imu(payload);
+        unsigned rate = strtoul(args, &end, 10);
+        unsigned count = IMU_BURST_RECORDS;
+        if (*end == ' ') {
+            count = strtoul(end + 1, &end, 10);
+        }
 
-    int len = strlen(payload);
-    memcpy(response, payload, len);
+        int res = (*end == '\0') ? imu_burst_start(rate, count) : -EINVAL;
+        if (res == -EBUSY) {
+            resp = COAP_RSPCODE_SERVICE_UNAVAILABLE;
+        }
+        else if (res < 0) {
+            resp = COAP_RSPCODE_BAD_REQUEST;
+        }
+    }
 
-    return coap_make_response(scratch, outpkt, (const uint8_t *)response, len,
-                              id_hi, id_lo, &inpkt->tok, COAP_RSPCODE_CONTENT,
-                              COAP_CONTENTTYPE_TEXT_PLAIN);
+    return coap_make_response(scratch, outpkt, NULL, 0, id_hi, id_lo,
+                              &inpkt->tok, resp, COAP_CONTENTTYPE_TEXT_PLAIN);
 }
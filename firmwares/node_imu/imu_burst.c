@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "msg.h"
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+#include "saul_sampler.h"
+
+#include "imu_burst.h"
+
+static char burst_stack[THREAD_STACKSIZE_DEFAULT];
+static kernel_pid_t burst_pid = KERNEL_PID_UNDEF;
+static scheduler_job_t *ready_job = NULL;
+
+/* ring buffer of records, the oldest one at ring_head */
+static int16_t ring[IMU_BURST_RECORDS][IMU_BURST_VALUES];
+static unsigned ring_head = 0;
+static unsigned ring_count = 0;
+static uint32_t ring_first;         /* sample index of the oldest record */
+static mutex_t ring_lock = MUTEX_INIT;
+
+/* current burst */
+static volatile int running = 0;
+static uint32_t period;             /* us */
+static unsigned samples;
+static uint32_t start;              /* timestamp of the first sample */
+static int8_t scale[3];
+
+/* the burst thread reads the sensors through its own handles */
+static const uint8_t burst_types[] = {
+    SAUL_SENSE_ACCEL, SAUL_SENSE_MAG, SAUL_SENSE_GYRO
+};
+static saul_sampler_t burst_sampler;
+
+static void _push(const phydat_t *data, uint32_t index)
+{
+    mutex_lock(&ring_lock);
+    if (ring_count == IMU_BURST_RECORDS) {
+        /* drop the oldest record, keeping the buffer contiguous */
+        ring_head = (ring_head + 1) % IMU_BURST_RECORDS;
+        ring_count--;
+        ring_first++;
+    }
+    if (ring_count == 0) {
+        ring_first = index;
+    }
+
+    int16_t *record = ring[(ring_head + ring_count) % IMU_BURST_RECORDS];
+    for (unsigned i = 0; i < 3; i++) {
+        record[3 * i] = data[i].val[0];
+        record[3 * i + 1] = data[i].val[1];
+        record[3 * i + 2] = data[i].val[2];
+    }
+    ring_count++;
+    mutex_unlock(&ring_lock);
+}
+
+static void _notify(void)
+{
+    if (ready_job == NULL) {
+        return;
+    }
+    /* never block sampling, a pending job is enough */
+    scheduler_post(ready_job);
+}
+
+static void *_burst_thread(void *arg)
+{
+    (void)arg;
+    msg_t msg;
+    phydat_t data[3];
+
+    for (;;) {
+        msg_receive(&msg);
+
+        /* records left from a previous burst would get wrong timestamps */
+        mutex_lock(&ring_lock);
+        ring_head = 0;
+        ring_count = 0;
+        mutex_unlock(&ring_lock);
+
+        xtimer_ticks32_t last_wakeup = xtimer_now();
+        start = xtimer_now_usec();
+
+        for (uint32_t index = 0; index < samples; index++) {
+            if (saul_sampler_read(&burst_sampler, data) < 0) {
+                /* records must stay consecutive, stop the burst here */
+                break;
+            }
+            if (index == 0) {
+                scale[0] = data[0].scale;
+                scale[1] = data[1].scale;
+                scale[2] = data[2].scale;
+            }
+            _push(data, index);
+
+            if (((index + 1) % IMU_BURST_BATCH) == 0) {
+                _notify();
+            }
+            xtimer_periodic_wakeup(&last_wakeup, period);
+        }
+
+        running = 0;
+        _notify();
+    }
+
+    return NULL;
+}
+
+int imu_burst_init(scheduler_job_t *ready)
+{
+    ready_job = ready;
+    saul_sampler_init(&burst_sampler, burst_types, sizeof(burst_types));
+
+    /* above the network stack users, sampling must not wait for them */
+    burst_pid = thread_create(burst_stack, sizeof(burst_stack),
+                              THREAD_PRIORITY_MAIN - 2,
+                              THREAD_CREATE_STACKTEST, _burst_thread,
+                              NULL, "IMU burst thread");
+    if (burst_pid == -EINVAL || burst_pid == -EOVERFLOW) {
+        puts("Error: failed to create imu burst thread");
+        return -1;
+    }
+    return 0;
+}
+
+int imu_burst_start(unsigned rate, unsigned count)
+{
+    msg_t msg;
+
+    if ((rate < IMU_BURST_RATE_MIN) || (rate > IMU_BURST_RATE_MAX) ||
+        (count == 0)) {
+        return -EINVAL;
+    }
+    if (running || (burst_pid == KERNEL_PID_UNDEF)) {
+        return -EBUSY;
+    }
+
+    period = 1000000U / rate;
+    samples = count;
+    running = 1;
+    if (msg_try_send(&msg, burst_pid) != 1) {
+        running = 0;
+        return -EBUSY;
+    }
+    return 0;
+}
+
+int imu_burst_running(void)
+{
+    return running;
+}
+
+unsigned imu_burst_available(void)
+{
+    return ring_count;
+}
+
+static uint8_t *_put_u16(uint8_t *p, uint16_t value)
+{
+    *p++ = value >> 8;
+    *p++ = value & 0xff;
+    return p;
+}
+
+size_t imu_burst_drain(uint8_t *buf)
+{
+    uint8_t *p = buf;
+
+    mutex_lock(&ring_lock);
+    unsigned count = ring_count;
+    if (count == 0) {
+        mutex_unlock(&ring_lock);
+        return 0;
+    }
+    if (count > IMU_BURST_BATCH) {
+        count = IMU_BURST_BATCH;
+    }
+
+    uint32_t t0 = start + ring_first * period;
+    p = _put_u16(p, t0 >> 16);
+    p = _put_u16(p, t0 & 0xffff);
+    p = _put_u16(p, period);
+    *p++ = count;
+    *p++ = scale[0];
+    *p++ = scale[1];
+    *p++ = scale[2];
+
+    for (unsigned r = 0; r < count; r++) {
+        const int16_t *record = ring[ring_head];
+        for (unsigned i = 0; i < IMU_BURST_VALUES; i++) {
+            p = _put_u16(p, record[i]);
+        }
+        ring_head = (ring_head + 1) % IMU_BURST_RECORDS;
+    }
+    ring_count -= count;
+    ring_first += count;
+    mutex_unlock(&ring_lock);
+
+    return p - buf;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * IMU burst capture.
+ *
+ * A high priority thread samples the accelerometer, magnetometer and
+ * gyroscope at a fixed rate (100 Hz to IMU_BURST_RATE_MAX) into a static ring
+ * buffer of binary records, independently of the network. Faster rates than
+ * the output data rates of the sensors would only repeat their values: the
+ * firmware Makefile raises them to at least IMU_BURST_RATE_MAX. Records are drained in
+ * batches, each one encoded as (all fields big endian):
+ *
+ *   uint32 t0        timestamp of the first record, in microseconds
+ *   uint16 period    sampling period, in microseconds
+ *   uint8  count     number of records
+ *   int8   scale[3]  decimal exponents of acc, mag and gyro values
+ *   int16  values[count][9]  acc xyz, mag xyz, gyro xyz
+ *
+ * When the ring buffer is full the oldest records are dropped, so a batch
+ * always holds consecutive samples.
+ */
+
+#ifndef IMU_BURST_H
+#define IMU_BURST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scheduler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMU_BURST_RATE_MIN      (100)   /* Hz */
+#ifndef IMU_BURST_RATE_MAX
+#define IMU_BURST_RATE_MAX      (200)   /* Hz, the magnetometer gives 220 */
+#endif
+
+#ifndef IMU_BURST_RECORDS
+#define IMU_BURST_RECORDS       (256)   /* ring buffer capacity */
+#endif
+
+#ifndef IMU_BURST_BATCH
+#define IMU_BURST_BATCH         (16)    /* records drained at once */
+#endif
+
+#define IMU_BURST_FORMAT        (42)    /* application/octet-stream */
+#define IMU_BURST_VALUES        (9)
+#define IMU_BURST_HDR_LEN       (10)
+#define IMU_BURST_BATCH_LEN     (IMU_BURST_HDR_LEN + \
+                                 IMU_BURST_BATCH * IMU_BURST_VALUES * 2)
+
+/* Create the sampling thread, which posts @p ready to the scheduler when a
+ * batch is ready (NULL for none). */
+int imu_burst_init(scheduler_job_t *ready);
+
+/* Start capturing @p samples records at @p rate Hz.
+ * Returns 0 on success, -EINVAL for a bad rate, -EBUSY if a burst is
+ * already running. */
+int imu_burst_start(unsigned rate, unsigned samples);
+
+/* Whether a burst is being captured. */
+int imu_burst_running(void);
+
+/* Number of records waiting in the ring buffer. */
+unsigned imu_burst_available(void);
+
+/* Move up to IMU_BURST_BATCH records into @p buf, which holds at least
+ * IMU_BURST_BATCH_LEN bytes. Returns the batch length, 0 if the ring
+ * buffer is empty. */
+size_t imu_burst_drain(uint8_t *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IMU_BURST_H */
@@ -13,65 +13,73 @@
 #include "thread.h"
 #include "xtimer.h"
 #include "board.h"
-#include "net/af.h"
-#include "net/gnrc/ipv6.h"
-#include "net/conn/udp.h"
-#include "saul_reg.h"
-
-#ifndef BROKER_ADDR
-#define BROKER_ADDR "2001:660:3207:102::4"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "microcoap_conn.h"
+#include "resources.h"
+#include "observe.h"
+#include "saul_sampler.h"
+#include "imu_burst.h"
+#ifdef MODULE_IOTKIT_SIM
+#include "sim.h"
 #endif
 
-#define BROKER_PORT 5683
-
-#define INTERVAL              (30000000U)    /* set interval to 30 seconds */
+#define APPLICATION_NAME      "IMU Unit"
 #define IMU_INTERVAL          (200000U)      /* set imu refresh interval to 200 ms */
 #define MAIN_QUEUE_SIZE       (8)
-#define BEACONING_QUEUE_SIZE  (8)
-#define IMU_QUEUE_SIZE  (8)
+#define IMU_READINGS          (9)            /* 3 axes of 3 sensors */
+
+#ifndef IMU_BURST_PUSH
+#define IMU_BURST_PUSH        (1)            /* push burst records to the broker */
+#endif
+#ifndef IMU_BURST_RETRY
+#define IMU_BURST_RETRY       (500000U)      /* resend a refused batch after 500 ms */
+#endif
 static msg_t _main_msg_queue[MAIN_QUEUE_SIZE];
-static msg_t _beaconing_msg_queue[BEACONING_QUEUE_SIZE];
-static char beaconing_stack[THREAD_STACKSIZE_DEFAULT];
-static msg_t _imu_msg_queue[IMU_QUEUE_SIZE];
-static char imu_stack[THREAD_STACKSIZE_DEFAULT];
-
-static coap_header_t req_hdr = {
-    .ver  = 1,
-    .t    = COAP_TYPE_NONCON,
-    .tkl  = 0,
-    .code = COAP_METHOD_POST,
-    .id   = {5, 57}            // is equivalent to 1337 when converted to uint16_t
-};
+static scheduler_job_t imu_job;
+static scheduler_job_t burst_job;
 
+/* accelerometer, magnetometer and gyroscope, looked up once */
+static const uint8_t imu_types[] = {
+    SAUL_SENSE_ACCEL, SAUL_SENSE_MAG, SAUL_SENSE_GYRO
+};
+static saul_sampler_t imu_sampler;
 static phydat_t data[3];
 static const char *types[] = {"acc", "mag", "gyro"};
-static char payload[512];
-static uint8_t response[512] = { 0 };
-
-/* broker  */
-static const char * broker_addr = BROKER_ADDR;
-static uint16_t pkt_id = 0;
+/* per axis metric names and units used by the binary encoders and observers */
+static const char *axes[3][3] = {
+    { "acc_x", "acc_y", "acc_z" },
+    { "mag_x", "mag_y", "mag_z" },
+    { "gyro_x", "gyro_y", "gyro_z" },
+};
+static const char *units[] = {"g", "Gs", "dps"};
 
-void microcoap_server_loop(void);
+static telemetry_path_t burst_path;
+static uint8_t burst_batch[IMU_BURST_BATCH_LEN];
+static size_t burst_batch_len = 0;      /* drained, not pushed yet */
 
 /* import "ifconfig" shell command, used for printing addresses */
 extern int _netif_config(int argc, char **argv);
 
-void _read_imu(char* payload)
+static int _sample_imu(void)
 {
-    /* get sensors */
-    saul_reg_t *acc = saul_reg_find_type(SAUL_SENSE_ACCEL);
-    saul_reg_t *mag = saul_reg_find_type(SAUL_SENSE_MAG);
-    saul_reg_t *gyr = saul_reg_find_type(SAUL_SENSE_GYRO);
-    if ((acc == NULL) || (mag == NULL) || (gyr == NULL)) {
-        puts("Unable to find sensors");
-        return;
-    }
+    return saul_sampler_read(&imu_sampler, data);
+}
 
-    saul_reg_read(acc, &data[0]);
-    saul_reg_read(mag, &data[1]);
-    saul_reg_read(gyr, &data[2]);
+static void _fill_readings(telemetry_reading_t *readings, uint32_t time)
+{
+    for (int i = 0; i < 3; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            readings[3 * i + axis] = (telemetry_reading_t) {
+                axes[i][axis], units[i], data[i].val[axis], data[i].scale,
+                time
+            };
+        }
+    }
+}
 
+static void _format_imu(char *payload)
+{
     size_t p = 0;
     p += sprintf(&payload[p], "[");
     for (int i = 0; i < 3; i++) {
@@ -82,82 +90,74 @@ void _read_imu(char* payload)
     p--;
     p += sprintf(&payload[p], "]");
     payload[p] = '\0';
-    
-    return;
 }
 
-void _send_coap_post(uint8_t* uri_path, uint8_t *data)
+int _read_imu_readings(telemetry_reading_t *readings)
 {
-    /* format destination address from string */
-    ipv6_addr_t dst_addr;
-    if (ipv6_addr_from_str(&dst_addr, broker_addr) == NULL) {
-        printf("Error: address not valid '%s'\n", broker_addr);
-        return;
+    if (_sample_imu() < 0) {
+        return -1;
     }
-    
-    pkt_id++;
-    req_hdr.id[0] = (uint8_t)(pkt_id >> 8);
-    req_hdr.id[1] = (uint8_t)(pkt_id << 8 / 255);
-    
-    uint8_t  snd_buf[128];
-    size_t   req_pkt_sz;
-    
-    coap_buffer_t payload = {
-        .p   = data,
-        .len = strlen((char*)data)
-    };
-    
-    coap_packet_t req_pkt;
-    req_pkt.hdr  = req_hdr;
-    req_pkt.tok  = (coap_buffer_t) { 0 };
-    req_pkt.numopts = 1;
-    req_pkt.opts[0].num = COAP_OPTION_URI_PATH;
-    req_pkt.opts[0].buf.p = uri_path;
-    req_pkt.opts[0].buf.len = strlen((char*)uri_path);
-    req_pkt.payload = payload;
-    
-    req_pkt_sz = sizeof(req_pkt);
-    
-    if (coap_build(snd_buf, &req_pkt_sz, &req_pkt) != 0) {
-        printf("CoAP build failed :(\n");
-        return;
-    }
-    
-    conn_udp_sendto(snd_buf, req_pkt_sz, NULL, 0,
-                    &dst_addr, sizeof(dst_addr),
-                    AF_INET6, 1234, BROKER_PORT);
+    _fill_readings(readings, xtimer_now_usec());
+    return 0;
 }
 
-void *imu_thread(void *args)
+int _read_imu(char* payload)
 {
-    msg_init_queue(_imu_msg_queue, IMU_QUEUE_SIZE);
-    
-    for(;;) {
-        size_t p = 0;
-        _read_imu(payload);
-        p += sprintf((char*)&response[p], "imu:");
-        p += sprintf((char*)&response[p], payload);
-        response[p] = '\0';
-        _send_coap_post((uint8_t*)"server", response);
-        /* wait 3 seconds */
-        xtimer_usleep(IMU_INTERVAL);
+    if (_sample_imu() < 0) {
+        return -1;
     }
-    return NULL;
+    _format_imu(payload);
+    return 0;
 }
 
-
-void *beaconing_thread(void *args)
+/* send the burst records, a batch per block-wise POST */
+static void _push_burst(void *arg)
 {
-    msg_init_queue(_beaconing_msg_queue, BEACONING_QUEUE_SIZE);
-    
-    for(;;) {
-        _send_coap_post((uint8_t*)"alive", (uint8_t*)"Alive");
-        /* wait 3 seconds */
-        xtimer_usleep(INTERVAL);
+    /* a batch per transfer: the end of the transfer runs this job again */
+    if (telemetry_transfer_busy()) {
+        return;
+    }
+
+    /* full batches while sampling, then whatever is left, after the batch
+       refused last time */
+    if ((burst_batch_len == 0) &&
+        ((imu_burst_available() >= IMU_BURST_BATCH) ||
+         (!imu_burst_running() && (imu_burst_available() > 0)))) {
+        burst_batch_len = imu_burst_drain(burst_batch);
+    }
+    if (burst_batch_len == 0) {
+        return;
     }
-    return NULL;
+
+    if (telemetry_send(&burst_path, burst_batch, burst_batch_len) < 0) {
+        /* single CON pushes may hold every in-flight entry, keep the batch
+           until one is free */
+        scheduler_add(&burst_job, _push_burst, NULL, IMU_BURST_RETRY, 0);
+        return;
+    }
+    burst_batch_len = 0;
 }
 
+static void _sample_sensors(void *arg)
+{
+    telemetry_reading_t readings[IMU_READINGS];
+
+    /* leave the sensors to the burst while it runs */
+    if (imu_burst_running()) {
+        return;
+    }
+
+    if (_sample_imu() < 0) {
+        return;
+    }
+    _fill_readings(readings, imu_job.due);
+    observe_notify("imu", readings, IMU_READINGS);
+
+    /* split over POSTs of a single frame in every format, the JSON document
+       would need a Block1 transfer, left to the burst records; refused
+       pushes are counted in telemetry_stats */
+    telemetry_send_readings(&telemetry_server, readings, IMU_READINGS);
+}
 
 int main(void)
 {
@@ -172,32 +172,28 @@ int main(void)
     /* print network addresses */
     puts("Configured network interfaces:");
     _netif_config(0, NULL);
-    
-    /* create the beaconning thread that will send periodic messages to
-       the broker */
-    int beacon_pid = thread_create(beaconing_stack, sizeof(beaconing_stack),
-                                   THREAD_PRIORITY_MAIN - 1,
-                                   THREAD_CREATE_STACKTEST, beaconing_thread,
-                                   NULL, "Beaconing thread");
-    if (beacon_pid == -EINVAL || beacon_pid == -EOVERFLOW) {
-        puts("Error: failed to create beaconing thread, exiting\n");
-    }
-    else {
-        puts("Successfuly created beaconing thread !\n");
-    }
-    
-    /* create the sensors thread that will send periodic updates to
-       the server */
-    int imu_pid = thread_create(imu_stack, sizeof(imu_stack),
-                                THREAD_PRIORITY_MAIN - 1,
-                                THREAD_CREATE_STACKTEST, imu_thread,
-                                NULL, "IMU thread");
-    if (imu_pid == -EINVAL || imu_pid == -EOVERFLOW) {
-        puts("Error: failed to create imu thread, exiting\n");
-    }
-    else {
-        puts("Successfuly created imu thread !\n");
-    }
+
+    /* resolve the broker address and prepare the CoAP request headers */
+    telemetry_init();
+    resources_init(APPLICATION_NAME, &imu_job, NULL);
+
+    /* look up the IMU sensors once */
+#ifdef MODULE_IOTKIT_SIM
+    sim_saul_init();
+#endif
+    saul_sampler_init(&imu_sampler, imu_types, sizeof(imu_types));
+    
+    /* create the burst sampling thread, records are pushed from the
+       scheduler thread or fetched on /imu/burst */
+    telemetry_path_init(&burst_path, "burst", IMU_BURST_FORMAT);
+    scheduler_job_init(&burst_job, _push_burst, NULL);
+    imu_burst_init(IMU_BURST_PUSH ? &burst_job : NULL);
+    telemetry_transfer_notify(IMU_BURST_PUSH ? &burst_job : NULL);
+
+    /* beacon and sample the imu from the scheduler thread */
+    telemetry_beacon_start();
+    scheduler_add(&imu_job, _sample_sensors, NULL, 0, IMU_INTERVAL);
+    scheduler_start();
     
     LED0_TOGGLE;
     LED1_TOGGLE;
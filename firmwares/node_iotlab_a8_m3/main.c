@@ -12,138 +12,89 @@
 #include "thread.h"
 #include "xtimer.h"
 #include "board.h"
-#include "net/af.h"
-#include "net/gnrc/ipv6.h"
-#include "net/conn/udp.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "microcoap_conn.h"
+#include "resources.h"
+#include "telemetry_batch.h"
+#include "fixed.h"
+#include "report.h"
+#include "observe.h"
+#include "sample_cache.h"
+#include "i2c_bus.h"
+#include "stats.h"
 #include "lsm303dlhc.h"
 
-#ifndef BROKER_ADDR
-#define BROKER_ADDR "2001:660:3207:102::4"
-#endif
+#define APPLICATION_NAME      "IoT-Lab A8 Node"
+#define SENSORS_INTERVAL       (5000000U)    /* set interval to 30 seconds */
 
-#define BROKER_PORT 5683
+#ifndef SENSORS_BATCH_CYCLES
+#define SENSORS_BATCH_CYCLES  (1)            /* sampling cycles pushed per batch */
+#endif
+#define SENSORS_BATCH_DELAY   (SENSORS_BATCH_CYCLES * SENSORS_INTERVAL)
 
-#define INTERVAL              (30000000U)    /* set interval to 30 seconds */
-#define SENSORS_INTERVAL       (5000000U)    /* set interval to 30 seconds */
 #define MAIN_QUEUE_SIZE       (8)
-#define BEACONING_QUEUE_SIZE  (8)
-#define SENSORS_QUEUE_SIZE    (8)
 
 static msg_t _main_msg_queue[MAIN_QUEUE_SIZE];
-static msg_t _beaconing_msg_queue[BEACONING_QUEUE_SIZE];
-static char beaconing_stack[THREAD_STACKSIZE_DEFAULT];
-
-static msg_t _sensors_msg_queue[SENSORS_QUEUE_SIZE];
-static char sensors_stack[THREAD_STACKSIZE_DEFAULT];
-
-static coap_header_t req_hdr = {
-    .ver  = 1,
-    .t    = COAP_TYPE_NONCON,
-    .tkl  = 0,
-    .code = COAP_METHOD_POST,
-    .id   = {5, 57}            // is equivalent to 1337 when converted to uint16_t
-};
 
-/* broker  */
-static const char * broker_addr = BROKER_ADDR;
-static uint16_t pkt_id = 0;
-static uint8_t response[512] = { 0 };
+static scheduler_job_t sensors_job;
+static telemetry_batch_t sensors_batch;
+static report_t sensors_report;
+
+/* deadbands of the pushed readings, in units of their last digit */
+static report_metric_t sensors_metrics[] = {
+    REPORT_METRIC("temperature", 1, 0),  /* 0.1 °C */
+};
 
 /* temperature sensor */
 #define I2C_INTERFACE I2C_DEV(0)    /* I2C interface number */
 
 static lsm303dlhc_t lsm303dlhc_dev;
-static int16_t s_temperature = 0;
-
-void microcoap_server_loop(void);
 
 /* import "ifconfig" shell command, used for printing addresses */
 extern int _netif_config(int argc, char **argv);
 
-void _read_temperature(int16_t * temperature)
+/* I2C transaction, run by the bus worker */
+static int _lsm303dlhc_temperature(void *arg)
 {
-    lsm303dlhc_read_temp(&lsm303dlhc_dev, temperature);
+    uint32_t start = stats_now();
+    int res = lsm303dlhc_read_temp(&lsm303dlhc_dev, arg);
+    stats_record(STATS_SENSOR, start);
+    return res;
 }
 
-void _send_coap_post(uint8_t* uri_path, uint8_t *data)
+int _read_temperature(int16_t * temperature)
 {
-    /* format destination address from string */
-    ipv6_addr_t dst_addr;
-    if (ipv6_addr_from_str(&dst_addr, broker_addr) == NULL) {
-        printf("Error: address not valid '%s'\n", broker_addr);
-        return;
+    int res = i2c_bus_run(_lsm303dlhc_temperature, temperature);
+    if (res < 0) {
+        puts("Error: cannot read the LSM303DLHC temperature");
     }
-    
-    pkt_id++;
-    req_hdr.id[0] = (uint8_t)(pkt_id >> 8);
-    req_hdr.id[1] = (uint8_t)(pkt_id << 8 / 255);
-    
-    uint8_t  snd_buf[128];
-    size_t   req_pkt_sz;
-    
-    coap_buffer_t payload = {
-        .p   = data,
-        .len = strlen((char*)data)
-    };
-    
-    coap_packet_t req_pkt;
-    req_pkt.hdr  = req_hdr;
-    req_pkt.tok  = (coap_buffer_t) { 0 };
-    req_pkt.numopts = 1;
-    req_pkt.opts[0].num = COAP_OPTION_URI_PATH;
-    req_pkt.opts[0].buf.p = uri_path;
-    req_pkt.opts[0].buf.len = strlen((char*)uri_path);
-    req_pkt.payload = payload;
-    
-    req_pkt_sz = sizeof(req_pkt);
-    
-    if (coap_build(snd_buf, &req_pkt_sz, &req_pkt) != 0) {
-        printf("CoAP build failed :(\n");
-        return;
-    }
-    
-    conn_udp_sendto(snd_buf, req_pkt_sz, NULL, 0,
-                    &dst_addr, sizeof(dst_addr),
-                    AF_INET6, 1234, BROKER_PORT);
+    return res;
 }
 
-void *sensors_thread(void *args)
+static void _sample_sensors(void *arg)
 {
-    msg_init_queue(_sensors_msg_queue, SENSORS_QUEUE_SIZE);
     int16_t tmp_temperature;
 
-    for(;;) {
-        lsm303dlhc_read_temp(&lsm303dlhc_dev, &tmp_temperature);
-        /* only send temperature update when changed */
-        //if (tmp_temperature != s_temperature) {
-        size_t p = 0;
-        p += sprintf((char*)&response[p], "temperature:");
-        p += sprintf((char*)&response[p],
-                     "%.1f°C", (double)tmp_temperature/128.0);
-        response[p] = '\0';
-        _send_coap_post((uint8_t*)"server", response);
-        s_temperature = tmp_temperature;
-        //}
-
-        /* wait 5 seconds */
-        xtimer_usleep(SENSORS_INTERVAL);
+    if (_read_temperature(&tmp_temperature) < 0) {
+        return;
     }
-
-    return NULL;
-}
-
-void *beaconing_thread(void *args)
-{
-    msg_init_queue(_beaconing_msg_queue, BEACONING_QUEUE_SIZE);
-    
-    for(;;) {
-        _send_coap_post((uint8_t*)"alive", (uint8_t*)"Alive");
-        /* wait 30 seconds */
-        xtimer_usleep(INTERVAL);
+    /* the sensor reports 1/128 °C, keep one decimal */
+    telemetry_reading_t reading = {
+        "temperature", "°C",
+        fixed_convert(tmp_temperature, &fixed_lsm303dlhc_temp),
+        fixed_lsm303dlhc_temp.scale, sensors_job.due
+    };
+    sample_cache_put(&reading);
+    observe_notify(reading.name, &reading, 1);
+    /* only push readings that moved beyond their deadband */
+    if (report_changed(&sensors_report, &reading)) {
+        telemetry_batch_add(&sensors_batch, &reading);
     }
-    return NULL;
-}
 
+    /* push the readings once enough cycles have been collected */
+    telemetry_batch_commit(&sensors_batch);
+}
 
 int main(void)
 {
@@ -158,6 +109,11 @@ int main(void)
     /* print network addresses */
     puts("Configured network interfaces:");
     _netif_config(0, NULL);
+
+    /* resolve the broker address and prepare the CoAP request headers */
+    telemetry_init();
+    resources_init(APPLICATION_NAME, &sensors_job, &sensors_report);
+    sample_cache_init(&sensors_job);
     
     printf("+------------Initializing temperature device ------------+\n");
     /* Initialise the I2C serial interface as master */
@@ -177,31 +133,18 @@ int main(void)
         printf("Sensor successfuly initialized!");
     }
     
-    /* create the beaconning thread that will send periodic messages to
-       the broker */
-    int beacon_pid = thread_create(beaconing_stack, sizeof(beaconing_stack),
-                                   THREAD_PRIORITY_MAIN - 1,
-                                   THREAD_CREATE_STACKTEST, beaconing_thread,
-                                   NULL, "Beaconing thread");
-    if (beacon_pid == -EINVAL || beacon_pid == -EOVERFLOW) {
-        puts("Error: failed to create beaconing thread, exiting\n");
-    }
-    else {
-        puts("Successfuly created beaconing thread !\n");
-    }
-    
-    /* create the sensors thread that will send periodic updates to
-       the server */
-    int sensors_pid = thread_create(sensors_stack, sizeof(sensors_stack),
-                                    THREAD_PRIORITY_MAIN - 1,
-                                    THREAD_CREATE_STACKTEST, sensors_thread,
-                                    NULL, "Sensors thread");
-    if (sensors_pid == -EINVAL || sensors_pid == -EOVERFLOW) {
-        puts("Error: failed to create sensors thread, exiting\n");
-    }
-    else {
-        puts("Successfuly created sensors thread !\n");
-    }
+    report_init(&sensors_report, sensors_metrics,
+                sizeof(sensors_metrics) / sizeof(sensors_metrics[0]));
+    telemetry_batch_init(&sensors_batch, &telemetry_server,
+                         SENSORS_BATCH_CYCLES, SENSORS_BATCH_DELAY);
+
+    /* sensor reads from all threads go through the I2C bus worker */
+    i2c_bus_start();
+
+    /* beacon and sample the sensors from the scheduler thread */
+    telemetry_beacon_start();
+    scheduler_add(&sensors_job, _sample_sensors, NULL, 0, SENSORS_INTERVAL);
+    scheduler_start();
     
     /* start coap server loop */
     microcoap_server_loop();
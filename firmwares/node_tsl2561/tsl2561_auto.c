@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdint.h>
+
+#include "periph/i2c.h"
+#include "xtimer.h"
+
+#include "tsl2561_auto.h"
+
+#define TSL2561_CMD             (0x80)
+#define TSL2561_CMD_WORD        (0x20)
+#define TSL2561_REG_CONTROL     (0x00)
+#define TSL2561_REG_TIMING      (0x01)
+#define TSL2561_REG_ID          (0x0A)
+#define TSL2561_REG_DATA0       (0x0C)  /* CH0, full spectrum */
+#define TSL2561_REG_DATA1       (0x0E)  /* CH1, infrared */
+
+#define TSL2561_POWER_UP        (0x03)
+#define TSL2561_POWER_DOWN      (0x00)
+#define TSL2561_GAIN_16X        (0x10)
+#define TSL2561_PARTNO_CS       (0x1)
+#define TSL2561_PARTNO_T        (0x5)   /* T, FN and CL packages */
+
+#define TSL2561_INTEGRATIONS    (3)
+#define TSL2561_LUX_COEFS       (7)
+
+/* integer lux computation of the datasheet */
+#define LUX_SCALE               (14)
+#define RATIO_SCALE             (9)
+#define CH_SCALE                (10)
+
+/* integration times: 13.7 ms, 101 ms and 402 ms */
+static const uint32_t integration_time[] = { 14000, 102000, 403000 }; /* us */
+static const uint16_t full_scale[] = { 5047, 37177, 65535 };
+/* counts to 402 ms and 16x counts, in 1/2^CH_SCALE */
+static const uint32_t ch_scale[] = { 0x7517, 0x0fe7, 1 << CH_SCALE };
+
+/* lux = (b * CH0 - m * CH1) / 2^LUX_SCALE, by CH1/CH0 ratio up to k */
+typedef struct {
+    uint16_t k;
+    uint16_t b;
+    uint16_t m;
+} lux_coef_t;
+
+/* T, FN and CL packages (K1T to K7T) */
+static const lux_coef_t lux_coef_t_pkg[TSL2561_LUX_COEFS] = {
+    { 0x0040, 0x01f2, 0x01be },
+    { 0x0080, 0x0214, 0x02d1 },
+    { 0x00c0, 0x023f, 0x037b },
+    { 0x0100, 0x0270, 0x03fe },
+    { 0x0138, 0x016f, 0x01fc },
+    { 0x019a, 0x00d2, 0x00fb },
+    { 0x029a, 0x0018, 0x0012 },
+};
+
+/* CS package (K1C to K7C) */
+static const lux_coef_t lux_coef_cs_pkg[TSL2561_LUX_COEFS] = {
+    { 0x0043, 0x0204, 0x01ad },
+    { 0x0085, 0x0228, 0x02c1 },
+    { 0x00c8, 0x0253, 0x0363 },
+    { 0x010a, 0x0282, 0x03df },
+    { 0x014d, 0x0177, 0x01dd },
+    { 0x019a, 0x0101, 0x0127 },
+    { 0x029a, 0x0037, 0x002b },
+};
+
+static i2c_t i2c_dev;
+static uint8_t i2c_addr;
+static const lux_coef_t *lux_coef = lux_coef_t_pkg;   /* by part number */
+
+/* setting of the next read, the least sensitive one until the first */
+static uint8_t integration = 0;
+static uint8_t gain_16x = 0;
+
+static uint32_t _ch_scale(uint8_t integ, uint8_t gain)
+{
+    return gain ? ch_scale[integ] : ch_scale[integ] << 4;
+}
+
+static uint16_t _lux(uint32_t ch0, uint32_t ch1)
+{
+    uint32_t scale = _ch_scale(integration, gain_16x);
+    uint32_t channel0 = (ch0 * scale) >> CH_SCALE;
+    uint32_t channel1 = (ch1 * scale) >> CH_SCALE;
+    uint32_t ratio = 0;
+
+    if (channel0 != 0) {
+        ratio = (((channel1 << (RATIO_SCALE + 1)) / channel0) + 1) >> 1;
+    }
+
+    unsigned i = 0;
+    while ((i < TSL2561_LUX_COEFS) && (ratio > lux_coef[i].k)) {
+        i++;
+    }
+    if (i == TSL2561_LUX_COEFS) {
+        return 0;   /* almost only infrared (K8) */
+    }
+
+    uint32_t b = channel0 * lux_coef[i].b;
+    uint32_t m = channel1 * lux_coef[i].m;
+    uint32_t lux = (((b > m) ? b - m : 0) + (1 << (LUX_SCALE - 1))) >>
+                   LUX_SCALE;
+    return (lux > UINT16_MAX) ? UINT16_MAX : lux;
+}
+
+/* pick the setting of the next read from the CH0 @p level, in 402 ms and
+ * 16x counts */
+static void _choose(uint32_t level)
+{
+    integration = 0;
+    gain_16x = 0;
+
+    for (uint8_t integ = 0; integ < TSL2561_INTEGRATIONS; integ++) {
+        uint32_t max = full_scale[integ] * (100 - TSL2561_AUTO_HEADROOM) / 100;
+        for (int gain = 1; gain >= 0; gain--) {
+            uint32_t counts = (level << CH_SCALE) / _ch_scale(integ, gain);
+            if (counts <= max) {
+                /* kept if no shorter integration has the resolution */
+                integration = integ;
+                gain_16x = gain;
+                if (counts >= TSL2561_AUTO_COUNTS_MIN) {
+                    return;
+                }
+                break;
+            }
+        }
+    }
+}
+
+static int _write(uint8_t reg, uint8_t value)
+{
+    return i2c_write_reg(i2c_dev, i2c_addr, TSL2561_CMD | reg, value);
+}
+
+static int _read_channel(uint8_t reg, uint16_t *counts)
+{
+    uint8_t buf[2];
+
+    if (i2c_read_regs(i2c_dev, i2c_addr,
+                      TSL2561_CMD | TSL2561_CMD_WORD | reg, buf, 2) != 2) {
+        return -1;
+    }
+    *counts = buf[0] | (buf[1] << 8);
+    return 0;
+}
+
+/* power up for a single integration with the current setting */
+static int _measure(uint16_t *ch0, uint16_t *ch1)
+{
+    i2c_acquire(i2c_dev);
+    int res = _write(TSL2561_REG_TIMING,
+                     (gain_16x ? TSL2561_GAIN_16X : 0) | integration);
+    if (res >= 0) {
+        res = _write(TSL2561_REG_CONTROL, TSL2561_POWER_UP);
+    }
+    i2c_release(i2c_dev);
+    if (res < 0) {
+        return -1;
+    }
+
+    xtimer_usleep(integration_time[integration]);
+
+    i2c_acquire(i2c_dev);
+    res = _read_channel(TSL2561_REG_DATA0, ch0);
+    if (res >= 0) {
+        res = _read_channel(TSL2561_REG_DATA1, ch1);
+    }
+    _write(TSL2561_REG_CONTROL, TSL2561_POWER_DOWN);
+    i2c_release(i2c_dev);
+    return res;
+}
+
+int tsl2561_auto_init(i2c_t dev, uint8_t addr)
+{
+    uint8_t id;
+
+    i2c_dev = dev;
+    i2c_addr = addr;
+
+    i2c_acquire(i2c_dev);
+    if (i2c_init_master(i2c_dev, I2C_SPEED_NORMAL) != 0) {
+        i2c_release(i2c_dev);
+        return -1;
+    }
+    if ((i2c_read_reg(i2c_dev, i2c_addr, TSL2561_CMD | TSL2561_REG_ID,
+                      &id) != 1) ||
+        (((id >> 4) != TSL2561_PARTNO_CS) && ((id >> 4) != TSL2561_PARTNO_T)) ||
+        (_write(TSL2561_REG_CONTROL, TSL2561_POWER_DOWN) < 0)) {
+        i2c_release(i2c_dev);
+        return -2;
+    }
+    i2c_release(i2c_dev);
+
+    /* the packages filter the light differently */
+    lux_coef = ((id >> 4) == TSL2561_PARTNO_CS) ? lux_coef_cs_pkg
+                                                : lux_coef_t_pkg;
+    return 0;
+}
+
+int tsl2561_auto_read(uint16_t *illuminance)
+{
+    uint16_t ch0, ch1;
+
+    for (;;) {
+        if (_measure(&ch0, &ch1) < 0) {
+            return -1;
+        }
+        if (((ch0 < full_scale[integration]) &&
+             (ch1 < full_scale[integration])) ||
+            ((integration == 0) && !gain_16x)) {
+            /* beyond the least sensitive setting the sensor is out of
+               range, the reading is its full scale */
+            break;
+        }
+        /* saturated, the light rose since the last read */
+        integration = 0;
+        gain_16x = 0;
+    }
+
+    *illuminance = _lux(ch0, ch1);
+    _choose((ch0 * _ch_scale(integration, gain_16x)) >> CH_SCALE);
+    return 0;
+}
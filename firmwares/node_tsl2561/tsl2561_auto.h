@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Auto-ranging TSL2561 reads.
+ *
+ * The RIOT driver keeps the gain and integration time given at init: a long
+ * integration saturates in sunlight and blocks the reading thread for
+ * 402 ms, a short one loses resolution in the dark. Here each read powers
+ * the sensor up for a single integration, with a setting chosen from the
+ * channel counts of the previous read: the shortest integration time whose
+ * highest non-saturating gain still gives TSL2561_AUTO_COUNTS_MIN counts,
+ * with TSL2561_AUTO_HEADROOM percent of the full scale left for the light
+ * to change. A saturated read is taken again at the lowest sensitivity, so
+ * no reading comes from a saturated channel. The counts are converted with
+ * the integer lux computation of the datasheet, with the coefficients of
+ * the package given by the part number (CS, or T, FN and CL).
+ */
+
+#ifndef TSL2561_AUTO_H
+#define TSL2561_AUTO_H
+
+#include <stdint.h>
+
+#include "periph/i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TSL2561_AUTO_COUNTS_MIN
+#define TSL2561_AUTO_COUNTS_MIN     (1000)  /* 0.1 % quantization */
+#endif
+
+#ifndef TSL2561_AUTO_HEADROOM
+#define TSL2561_AUTO_HEADROOM       (25)    /* % of the full scale */
+#endif
+
+/* Check the sensor at @p addr on @p dev and power it down. Returns 0 on
+ * success, -1 if the I2C bus cannot be used, -2 if no TSL2561 answers. */
+int tsl2561_auto_init(i2c_t dev, uint8_t addr);
+
+/* Integrate once and store the illuminance in lx into @p illuminance,
+ * sleeping through the integration. Returns 0 on success, -1 on a bus
+ * error. */
+int tsl2561_auto_read(uint16_t *illuminance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TSL2561_AUTO_H */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Simulated peripherals of the native board.
+ *
+ * The iotkit_sim module replaces the LSM303DLHC driver, the I2C bus of the
+ * BME280, BMP180, TSL2561 and AT30TSE75x, the user LED pin and the SAUL
+ * IMU, so that every firmware runs on the host behind a tap interface.
+ * It implements the functions of the RIOT drivers with their headers, and
+ * is selected by sim/Makefile.native when BOARD=native. The BME280 and the
+ * BMP180 both answer on address 0x77, only those of the firmware are on the
+ * bus (SIM_I2C_BME280, SIM_I2C_BMP180).
+ *
+ * Each reading follows a triangle wave around a typical value with some
+ * noise from a generator seeded with SIM_SEED, so report-on-change and the
+ * observers see values that move. With SIM_TIMING a read takes as long as
+ * its I2C transfers and conversion on the real sensor.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#include "board.h"
+#include "periph/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SIM_SEED
+#define SIM_SEED                (1U)
+#endif
+
+#ifndef SIM_TIMING
+#define SIM_TIMING              (1)     /* reads take the time of the sensor */
+#endif
+
+#define SIM_I2C_BYTE_TIME       (90U)   /* us per byte at 100 kHz, with ACK */
+
+#ifndef SIM_I2C_BME280
+#define SIM_I2C_BME280          (0)     /* BME280 registers on the bus */
+#endif
+
+#ifndef SIM_I2C_BMP180
+#define SIM_I2C_BMP180          (0)     /* BMP180 registers on the bus */
+#endif
+
+/* the native board has LED macros but no LED pin, /led drives a fake one */
+#ifndef LED0_PIN
+#define LED0_PIN                GPIO_PIN(0, 0)
+#define LED0_ACTIVE_LOW         (0)
+#endif
+#ifndef LED1_TOGGLE
+#define LED1_TOGGLE
+#endif
+#ifndef LED2_TOGGLE
+#define LED2_TOGGLE
+#endif
+
+/* a simulated physical quantity, in the units returned by the driver */
+typedef struct {
+    int32_t base;           /* center of the wave */
+    int32_t amplitude;      /* peak deviation from base */
+    uint32_t period;        /* period of the wave (s) */
+    int32_t noise;          /* peak uniform noise added to each reading */
+} sim_signal_t;
+
+/* Return the current value of @p signal. */
+int32_t sim_read(const sim_signal_t *signal);
+
+/* Wait @p us like a sensor conversion, if SIM_TIMING is set. */
+void sim_wait(uint32_t us);
+
+/* Wait for an I2C transfer of @p len bytes, if SIM_TIMING is set. */
+void sim_i2c_transfer(unsigned len);
+
+/* Register the simulated accelerometer, magnetometer and gyroscope in SAUL,
+ * before looking them up. */
+void sim_saul_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_H */
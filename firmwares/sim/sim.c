@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "irq.h"
+#include "periph/gpio.h"
+#include "xtimer.h"
+
+#include "sim.h"
+
+#define SIM_GPIO_NUMOF          (32)    /* pins with a simulated level */
+
+static uint32_t noise_state = SIM_SEED;
+static uint32_t gpio_levels;
+
+/* xorshift32, shared by the sampling and CoAP threads */
+static uint32_t _random(void)
+{
+    unsigned state = irq_disable();
+    uint32_t x = noise_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    noise_state = x;
+    irq_restore(state);
+    return x;
+}
+
+int32_t sim_read(const sim_signal_t *signal)
+{
+    uint32_t period = signal->period * 1000U;
+    uint32_t half = period / 2;
+    uint32_t phase = (uint32_t)((xtimer_now_usec64() / 1000U) % period);
+    /* distance to the bottom of the wave, from 0 to half */
+    uint32_t tri = (phase < half) ? phase : period - phase;
+    int32_t value = signal->base - signal->amplitude +
+                    (int32_t)((int64_t)2 * signal->amplitude * tri / half);
+
+    if (signal->noise > 0) {
+        value += (int32_t)(_random() % (2 * signal->noise + 1)) - signal->noise;
+    }
+    return value;
+}
+
+void sim_wait(uint32_t us)
+{
+#if SIM_TIMING
+    xtimer_usleep(us);
+#else
+    (void)us;
+#endif
+}
+
+void sim_i2c_transfer(unsigned len)
+{
+    /* address byte and register pointer, then the data */
+    sim_wait((len + 2) * SIM_I2C_BYTE_TIME);
+}
+
+/* the LED pin of /led, native has no GPIO peripheral */
+int gpio_init(gpio_t pin, gpio_mode_t mode)
+{
+    (void)mode;
+    return (pin < SIM_GPIO_NUMOF) ? 0 : -1;
+}
+
+int gpio_read(gpio_t pin)
+{
+    return (pin < SIM_GPIO_NUMOF) ? (int)((gpio_levels >> pin) & 1) : 0;
+}
+
+void gpio_write(gpio_t pin, int value)
+{
+    if (pin >= SIM_GPIO_NUMOF) {
+        return;
+    }
+    unsigned state = irq_disable();
+    if (value) {
+        gpio_levels |= (1UL << pin);
+    }
+    else {
+        gpio_levels &= ~(1UL << pin);
+    }
+    irq_restore(state);
+}
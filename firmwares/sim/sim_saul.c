@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/* The IMU of the iotlab-m3 board, as registered in SAUL by auto_init_saul. */
+
+#include <stddef.h>
+
+#include "saul.h"
+#include "saul_reg.h"
+
+#include "sim.h"
+
+typedef struct {
+    sim_signal_t axes[3];
+    uint8_t unit;
+    int8_t scale;
+} sim_saul_dev_t;
+
+/* lying flat and slowly wobbling */
+static const sim_saul_dev_t accel = {
+    { { 0, 30, 20, 8 }, { 0, 30, 30, 8 }, { 1000, 5, 20, 8 } },
+    UNIT_G, -3
+};
+static const sim_saul_dev_t mag = {
+    { { 220, 40, 60, 4 }, { -50, 40, 60, 4 }, { 410, 10, 60, 4 } },
+    UNIT_GS, -3
+};
+static const sim_saul_dev_t gyro = {
+    { { 0, 15, 20, 3 }, { 0, 15, 30, 3 }, { 0, 5, 40, 3 } },
+    UNIT_DPS, -1
+};
+
+static int _read(void *dev, phydat_t *res)
+{
+    const sim_saul_dev_t *sim = dev;
+
+    /* the three axes in a single burst */
+    sim_i2c_transfer(6);
+    for (unsigned i = 0; i < 3; i++) {
+        res->val[i] = (int16_t)sim_read(&sim->axes[i]);
+    }
+    res->unit = sim->unit;
+    res->scale = sim->scale;
+    return 3;
+}
+
+static const saul_driver_t accel_driver = {
+    _read, saul_notsup, SAUL_SENSE_ACCEL
+};
+static const saul_driver_t mag_driver = {
+    _read, saul_notsup, SAUL_SENSE_MAG
+};
+static const saul_driver_t gyro_driver = {
+    _read, saul_notsup, SAUL_SENSE_GYRO
+};
+
+static saul_reg_t saul_entries[] = {
+    { NULL, (void *)&accel, "sim-accel", &accel_driver },
+    { NULL, (void *)&mag, "sim-mag", &mag_driver },
+    { NULL, (void *)&gyro, "sim-gyro", &gyro_driver },
+};
+
+void sim_saul_init(void)
+{
+    for (unsigned i = 0; i < sizeof(saul_entries) / sizeof(saul_entries[0]);
+         i++) {
+        saul_reg_add(&saul_entries[i]);
+    }
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/* The I2C sensors of the firmwares, read at their register level timing. */
+
+#include <string.h>
+
+#include "periph/i2c.h"
+#include "lsm303dlhc.h"
+
+#include "sim.h"
+
+#define AT30TSE_ADDR            (0x48 | 0x07)   /* as wired on the IO1 XPlained */
+#define BME280_ADDR             (0x76)          /* or 0x77, SDO high */
+#define BMP180_ADDR             (0x77)
+#define TSL2561_ADDR            (0x39)          /* ADDR SEL floating */
+
+#define BME280_REG_RESET        (0xE0)
+#define BME280_REG_DATA         (0xF7)
+#define BME280_REG_DATA_END     (0xFE)
+
+#define BMP180_REG_CTRL_MEAS    (0xF4)
+#define BMP180_REG_DATA         (0xF6)
+#define BMP180_CMD_TEMPERATURE  (0x2E)
+#define BMP180_CMD_PRESSURE     (0x34)
+#define BMP180_CTRL_SCO         (0x20)
+
+#define TSL2561_CMD_REG         (0x0f)  /* register in the command byte */
+#define TSL2561_REG_TIMING      (0x01)
+#define TSL2561_REG_DATA0       (0x0C)
+#define TSL2561_GAIN_16X        (0x10)
+
+/* 21.5 °C indoors, drifting by 1.5 °C every 10 minutes */
+static const sim_signal_t bmp180_temperature = { 215, 15, 600, 1 };     /* 0.1 °C */
+static const sim_signal_t bmp180_pressure = { 101325, 150, 1800, 5 };   /* Pa */
+static const sim_signal_t bme280_temperature = { 2150, 150, 600, 5 };   /* 0.01 °C */
+static const sim_signal_t bme280_pressure = { 101325, 150, 1800, 5 };   /* Pa */
+static const sim_signal_t bme280_humidity = { 4500, 1000, 900, 20 };    /* 0.01 % */
+static const sim_signal_t tsl2561_illuminance = { 320, 300, 300, 4 };   /* lx */
+static const sim_signal_t lsm303dlhc_temperature = { 2752, 192, 600, 6 }; /* 1/128 °C */
+static const sim_signal_t at30tse_temperature = { 172, 12, 600, 1 };    /* 1/8 °C */
+
+/* TSL2561 full scale and counts to 402 ms and 16x counts in 1/1024, by
+ * integration time */
+static const uint16_t tsl2561_full_scale[] = { 5047, 37177, 65535 };
+static const uint32_t tsl2561_ch_scale[] = { 0x7517, 0x0fe7, 0x0400 };
+
+/* BMP180 register map, with a calibration reducing the compensation to
+ * T = (UT - 16384) / 16 and P = (2 * UP >> oss) plus the fixed second order
+ * correction: AC4 = 50000, AC5 = 32768, AC6 = 16384, MD = 1, the others 0 */
+static uint8_t bmp180_regs[256] = {
+    [0xB0] = 0xC3, [0xB1] = 0x50,   /* AC4 */
+    [0xB2] = 0x80,                  /* AC5 */
+    [0xB4] = 0x40,                  /* AC6 */
+    [0xBF] = 0x01,                  /* MD */
+    [0xD0] = 0x55,                  /* chip ID */
+};
+
+/* TSL2561 registers, a T package */
+static uint8_t tsl2561_regs[16] = {
+    [0x0A] = 0x50,                  /* ID */
+};
+
+/* BME280 register map, with a calibration the compensation formulas invert
+ * exactly: T1 = 32768, T2 = 16384, P1 = 6250, H2 = 128, the others 0 */
+static uint8_t bme280_regs[256] = {
+    [0x89] = 0x80, [0x8B] = 0x40,   /* dig_T1, dig_T2 */
+    [0x8E] = 0x6A, [0x8F] = 0x18,   /* dig_P1 */
+    [0xD0] = 0x60,                  /* chip ID */
+    [0xE1] = 0x80,                  /* dig_H2 */
+};
+
+/* second order correction of the BMP180 pressure, from the datasheet */
+static int32_t _bmp180_correction(int32_t p)
+{
+    int32_t x1 = (((p >> 8) * (p >> 8)) * 3038) >> 16;
+    int32_t x2 = (-7357 * p) >> 16;
+    return (x1 + x2 + 3791) >> 4;
+}
+
+/* fill the BMP180 data registers with the raw value of a conversion */
+static void _bmp180_convert(uint8_t cmd)
+{
+    uint8_t *data = &bmp180_regs[BMP180_REG_DATA];
+
+    if (cmd == BMP180_CMD_TEMPERATURE) {
+        uint32_t ut = 16384 + sim_read(&bmp180_temperature) * 16;
+        data[0] = ut >> 8;
+        data[1] = ut;
+    }
+    else if ((cmd & 0x3f) == BMP180_CMD_PRESSURE) {
+        unsigned oss = cmd >> 6;
+        int32_t pressure = sim_read(&bmp180_pressure);
+        /* invert the correction, small enough to converge in a few steps */
+        int32_t p = pressure;
+        for (unsigned i = 0; i < 4; i++) {
+            p = pressure - _bmp180_correction(p);
+        }
+        uint32_t up = ((uint32_t)p << oss) >> 1;
+        uint32_t raw = up << (8 - oss);
+        data[0] = raw >> 16;
+        data[1] = raw >> 8;
+        data[2] = raw;
+    }
+}
+
+static int _bmp180_read(uint8_t reg, uint8_t *data, int length)
+{
+    if ((length < 0) || (reg + length > (int)sizeof(bmp180_regs))) {
+        return -1;
+    }
+    sim_i2c_transfer(length);
+    memcpy(data, &bmp180_regs[reg], length);
+    return length;
+}
+
+/* conversions are immediate, SCO reads cleared right away */
+static int _bmp180_write(uint8_t reg, uint8_t data)
+{
+    sim_i2c_transfer(1);
+    if (reg == BMP180_REG_CTRL_MEAS) {
+        _bmp180_convert(data);
+        bmp180_regs[reg] = data & ~BMP180_CTRL_SCO;
+    }
+    return 1;
+}
+
+/* fill the BME280 measurement registers with the raw values of the
+ * signals, under the calibration of bme280_regs */
+static void _bme280_convert(void)
+{
+    uint32_t adc_t = 524288 + sim_read(&bme280_temperature) * 256 / 5;
+    uint32_t adc_p = 1048576 - sim_read(&bme280_pressure);
+    int32_t humidity = sim_read(&bme280_humidity);
+    uint32_t adc_h = ((humidity < 0) ? 0 : humidity) * 512 / 100;
+    uint8_t *data = &bme280_regs[BME280_REG_DATA];
+
+    data[0] = adc_p >> 12;
+    data[1] = adc_p >> 4;
+    data[2] = adc_p << 4;
+    data[3] = adc_t >> 12;
+    data[4] = adc_t >> 4;
+    data[5] = adc_t << 4;
+    data[6] = (adc_h > 0xffff) ? 0xff : adc_h >> 8;
+    data[7] = (adc_h > 0xffff) ? 0xff : adc_h;
+}
+
+static int _bme280_read(uint8_t reg, uint8_t *data, int length)
+{
+    if ((length < 0) || (reg + length > (int)sizeof(bme280_regs))) {
+        return -1;
+    }
+    sim_i2c_transfer(length);
+
+    /* conversions are immediate, the status never reads measuring */
+    if ((reg <= BME280_REG_DATA_END) && (reg + length > BME280_REG_DATA)) {
+        _bme280_convert();
+    }
+    memcpy(data, &bme280_regs[reg], length);
+    return length;
+}
+
+static int _bme280_write(uint8_t reg, uint8_t data)
+{
+    sim_i2c_transfer(1);
+    if (reg != BME280_REG_RESET) {
+        bme280_regs[reg] = data;
+    }
+    return 1;
+}
+
+/* fill the TSL2561 channels with the counts of the signal under the
+ * current gain and integration time, as visible light only: the datasheet
+ * lux computation then reduces to 498 * CH0 / 2^14 in 402 ms and 16x counts */
+static void _tsl2561_integrate(void)
+{
+    uint8_t timing = tsl2561_regs[TSL2561_REG_TIMING];
+    unsigned integ = ((timing & 0x03) > 2) ? 2 : (timing & 0x03);
+    uint32_t scale = tsl2561_ch_scale[integ];
+    int32_t lux = sim_read(&tsl2561_illuminance);
+
+    if (!(timing & TSL2561_GAIN_16X)) {
+        scale <<= 4;
+    }
+    uint32_t level = (((uint32_t)((lux < 0) ? 0 : lux) << 14) + 249) / 498;
+    uint32_t counts = ((level << 10) + scale / 2) / scale;
+    if (counts > tsl2561_full_scale[integ]) {
+        counts = tsl2561_full_scale[integ];
+    }
+    tsl2561_regs[TSL2561_REG_DATA0] = counts;
+    tsl2561_regs[TSL2561_REG_DATA0 + 1] = counts >> 8;
+    tsl2561_regs[TSL2561_REG_DATA0 + 2] = 0;
+    tsl2561_regs[TSL2561_REG_DATA0 + 3] = 0;
+}
+
+static int _tsl2561_read(uint8_t cmd, uint8_t *data, int length)
+{
+    uint8_t reg = cmd & TSL2561_CMD_REG;
+
+    if ((length < 0) || (reg + length > (int)sizeof(tsl2561_regs))) {
+        return -1;
+    }
+    sim_i2c_transfer(length);
+    if (reg == TSL2561_REG_DATA0) {
+        _tsl2561_integrate();
+    }
+    memcpy(data, &tsl2561_regs[reg], length);
+    return length;
+}
+
+static int _tsl2561_write(uint8_t cmd, uint8_t data)
+{
+    sim_i2c_transfer(1);
+    tsl2561_regs[cmd & TSL2561_CMD_REG] = data;
+    return 1;
+}
+
+int lsm303dlhc_init(lsm303dlhc_t *dev, i2c_t i2c, gpio_t acc_pin,
+                    gpio_t mag_pin, uint8_t acc_address,
+                    lsm303dlhc_acc_sample_rate_t acc_sample_rate,
+                    lsm303dlhc_acc_scale_t acc_scale, uint8_t mag_address,
+                    lsm303dlhc_mag_sample_rate_t mag_sample_rate,
+                    lsm303dlhc_mag_gain_t mag_gain)
+{
+    (void)acc_sample_rate;
+    (void)acc_scale;
+    (void)mag_sample_rate;
+    (void)mag_gain;
+    dev->i2c = i2c;
+    dev->acc_address = acc_address;
+    dev->mag_address = mag_address;
+    dev->acc_pin = acc_pin;
+    dev->mag_pin = mag_pin;
+    sim_i2c_transfer(4);
+    sim_i2c_transfer(4);
+    return 0;
+}
+
+int lsm303dlhc_read_temp(const lsm303dlhc_t *dev, int16_t *value)
+{
+    (void)dev;
+    sim_i2c_transfer(2);
+    *value = (int16_t)sim_read(&lsm303dlhc_temperature);
+    return 0;
+}
+
+/* the BME280, BMP180 and TSL2561 registers and the AT30TSE75x temperature
+ * register of node_ioxplained answer on the bus */
+int i2c_init_master(i2c_t dev, i2c_speed_t speed)
+{
+    (void)speed;
+    return (dev == I2C_DEV(0)) ? 0 : -1;
+}
+
+int i2c_acquire(i2c_t dev)
+{
+    (void)dev;
+    return 0;
+}
+
+int i2c_release(i2c_t dev)
+{
+    (void)dev;
+    return 0;
+}
+
+int i2c_read_bytes(i2c_t dev, uint8_t address, void *data, int length)
+{
+    uint8_t *buf = data;
+
+    if ((dev != I2C_DEV(0)) || (address != AT30TSE_ADDR) || (length < 2)) {
+        return -1;
+    }
+    sim_i2c_transfer(length);
+
+    /* sign and magnitude in 1/8 °C, left aligned on 16 bits */
+    int32_t temp = sim_read(&at30tse_temperature);
+    uint16_t reg = (uint16_t)(((temp < 0) ? -temp : temp) << 5);
+    if (temp < 0) {
+        reg |= (1 << 15);
+    }
+    memset(buf, 0, length);
+    buf[0] = reg >> 8;
+    buf[1] = reg & 0xff;
+    return length;
+}
+
+static int _is_bme280(i2c_t dev, uint8_t address)
+{
+    return SIM_I2C_BME280 && (dev == I2C_DEV(0)) &&
+           ((address & ~0x01) == BME280_ADDR);
+}
+
+static int _is_bmp180(i2c_t dev, uint8_t address)
+{
+    return SIM_I2C_BMP180 && (dev == I2C_DEV(0)) && (address == BMP180_ADDR);
+}
+
+static int _is_tsl2561(i2c_t dev, uint8_t address)
+{
+    return (dev == I2C_DEV(0)) && (address == TSL2561_ADDR);
+}
+
+int i2c_read_reg(i2c_t dev, uint8_t address, uint8_t reg, void *data)
+{
+    return i2c_read_regs(dev, address, reg, data, 1);
+}
+
+int i2c_read_regs(i2c_t dev, uint8_t address, uint8_t reg, void *data,
+                  int length)
+{
+    if (_is_bme280(dev, address)) {
+        return _bme280_read(reg, data, length);
+    }
+    if (_is_bmp180(dev, address)) {
+        return _bmp180_read(reg, data, length);
+    }
+    if (_is_tsl2561(dev, address)) {
+        return _tsl2561_read(reg, data, length);
+    }
+    return -1;
+}
+
+int i2c_write_reg(i2c_t dev, uint8_t address, uint8_t reg, uint8_t data)
+{
+    if (_is_bme280(dev, address)) {
+        return _bme280_write(reg, data);
+    }
+    if (_is_bmp180(dev, address)) {
+        return _bmp180_write(reg, data);
+    }
+    if (_is_tsl2561(dev, address)) {
+        return _tsl2561_write(reg, data);
+    }
+    return -1;
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "embUnit.h"
+
+#include "tests.h"
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_cbor_tests());
+    TESTS_RUN(tests_fixed_tests());
+    TESTS_RUN(tests_telemetry_encode_tests());
+    TESTS_END();
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "cbor.h"
+#include "tests.h"
+
+/* the expected encodings are the examples of RFC 7049, appendix A */
+
+static cbor_writer_t writer;
+static uint8_t buf[32];
+
+static void set_up(void)
+{
+    memset(buf, 0xee, sizeof(buf));
+    cbor_writer_init(&writer, buf, sizeof(buf));
+}
+
+static void test_cbor_put_uint(void)
+{
+    static const uint8_t expected[] = {
+        0x00, 0x17, 0x18, 0x18, 0x18, 0x64, 0x19, 0x03, 0xe8,
+        0x1a, 0x00, 0x0f, 0x42, 0x40
+    };
+
+    cbor_put_uint(&writer, 0);
+    cbor_put_uint(&writer, 23);
+    cbor_put_uint(&writer, 24);
+    cbor_put_uint(&writer, 100);
+    cbor_put_uint(&writer, 1000);
+    cbor_put_uint(&writer, 1000000);
+    TEST_ASSERT_BYTES(expected, buf, cbor_writer_len(&writer));
+}
+
+static void test_cbor_put_int(void)
+{
+    static const uint8_t expected[] = {
+        0x01, 0x20, 0x29, 0x38, 0x63, 0x39, 0x03, 0xe7,
+        0x3a, 0x7f, 0xff, 0xff, 0xff
+    };
+
+    cbor_put_int(&writer, 1);
+    cbor_put_int(&writer, -1);
+    cbor_put_int(&writer, -10);
+    cbor_put_int(&writer, -100);
+    cbor_put_int(&writer, -1000);
+    cbor_put_int(&writer, INT32_MIN);
+    TEST_ASSERT_BYTES(expected, buf, cbor_writer_len(&writer));
+}
+
+static void test_cbor_put_text(void)
+{
+    static const uint8_t expected[] = {
+        0x60, 0x61, 0x61, 0x64, 0x49, 0x45, 0x54, 0x46
+    };
+
+    cbor_put_text(&writer, "");
+    cbor_put_text(&writer, "a");
+    cbor_put_text(&writer, "IETF");
+    TEST_ASSERT_BYTES(expected, buf, cbor_writer_len(&writer));
+}
+
+static void test_cbor_put_containers(void)
+{
+    /* [1, [2, 3], {"a": 1}] */
+    static const uint8_t expected[] = {
+        0x83, 0x01, 0x82, 0x02, 0x03, 0xa1, 0x61, 0x61, 0x01
+    };
+
+    cbor_put_array(&writer, 3);
+    cbor_put_uint(&writer, 1);
+    cbor_put_array(&writer, 2);
+    cbor_put_uint(&writer, 2);
+    cbor_put_uint(&writer, 3);
+    cbor_put_map(&writer, 1);
+    cbor_put_text(&writer, "a");
+    cbor_put_uint(&writer, 1);
+    TEST_ASSERT_BYTES(expected, buf, cbor_writer_len(&writer));
+}
+
+static void test_cbor_put_decimal_fraction(void)
+{
+    /* 4([-2, 27315]), 273.15 */
+    static const uint8_t expected[] = {
+        0xc4, 0x82, 0x21, 0x19, 0x6a, 0xb3
+    };
+
+    cbor_put_tag(&writer, CBOR_TAG_DECIMAL_FRACTION);
+    cbor_put_array(&writer, 2);
+    cbor_put_int(&writer, -2);
+    cbor_put_int(&writer, 27315);
+    TEST_ASSERT_BYTES(expected, buf, cbor_writer_len(&writer));
+}
+
+static void test_cbor_overflow(void)
+{
+    cbor_writer_init(&writer, buf, 4);
+    cbor_put_uint(&writer, 1000);
+    TEST_ASSERT_EQUAL_INT(3, cbor_writer_len(&writer));
+
+    /* counted but not written past the end */
+    cbor_put_text(&writer, "IETF");
+    TEST_ASSERT_EQUAL_INT(-1, cbor_writer_len(&writer));
+    TEST_ASSERT_EQUAL_INT(0x64, buf[3]);
+    TEST_ASSERT_EQUAL_INT(0xee, buf[4]);
+}
+
+Test *tests_cbor_tests(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_cbor_put_uint),
+        new_TestFixture(test_cbor_put_int),
+        new_TestFixture(test_cbor_put_text),
+        new_TestFixture(test_cbor_put_containers),
+        new_TestFixture(test_cbor_put_decimal_fraction),
+        new_TestFixture(test_cbor_overflow),
+    };
+
+    EMB_UNIT_TESTCALLER(cbor_tests, set_up, NULL, fixtures);
+
+    return (Test *)&cbor_tests;
+}
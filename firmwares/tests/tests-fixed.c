@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "fixed.h"
+#include "tests.h"
+
+static char buf[16];
+
+static void set_up(void)
+{
+    memset(buf, 0, sizeof(buf));
+}
+
+static void test_fixed_convert(void)
+{
+    /* AT30TSE75x, 1/8 °C per LSB to 0.1 °C */
+    TEST_ASSERT_EQUAL_INT(250, fixed_convert(200, &fixed_at30tse_temp));
+    TEST_ASSERT_EQUAL_INT(3, fixed_convert(2, &fixed_at30tse_temp));
+    TEST_ASSERT_EQUAL_INT(1, fixed_convert(1, &fixed_at30tse_temp));
+    /* BMP180, no shift */
+    TEST_ASSERT_EQUAL_INT(101325, fixed_convert(101325,
+                                                &fixed_bmp180_pressure));
+    TEST_ASSERT_EQUAL_INT(-7, fixed_convert(-7, &fixed_bmp180_pressure));
+}
+
+static void test_fixed_convert_negative(void)
+{
+    /* rounded to nearest, halves away from zero: -3.75, -2.5, -1.25 */
+    TEST_ASSERT_EQUAL_INT(-4, fixed_convert(-3, &fixed_at30tse_temp));
+    TEST_ASSERT_EQUAL_INT(-3, fixed_convert(-2, &fixed_at30tse_temp));
+    TEST_ASSERT_EQUAL_INT(-1, fixed_convert(-1, &fixed_at30tse_temp));
+    /* LSM303DLHC, 1/128 °C per LSB: -2.5, -2.42, -5 */
+    TEST_ASSERT_EQUAL_INT(-3, fixed_convert(-32, &fixed_lsm303dlhc_temp));
+    TEST_ASSERT_EQUAL_INT(-2, fixed_convert(-31, &fixed_lsm303dlhc_temp));
+    TEST_ASSERT_EQUAL_INT(-5, fixed_convert(-64, &fixed_lsm303dlhc_temp));
+
+    /* no bias towards either infinity */
+    for (int32_t raw = 1; raw < 1024; raw++) {
+        TEST_ASSERT_EQUAL_INT(-fixed_convert(raw, &fixed_lsm303dlhc_temp),
+                              fixed_convert(-raw, &fixed_lsm303dlhc_temp));
+    }
+}
+
+static void test_fixed_fmt(void)
+{
+    TEST_ASSERT_EQUAL_INT(5, fixed_fmt(buf, sizeof(buf), 2153, -2));
+    TEST_ASSERT_EQUAL_STRING("21.53", buf);
+    TEST_ASSERT_EQUAL_INT(1, fixed_fmt(buf, sizeof(buf), 7, 0));
+    TEST_ASSERT_EQUAL_STRING("7", buf);
+    TEST_ASSERT_EQUAL_INT(5, fixed_fmt(buf, sizeof(buf), 5, -3));
+    TEST_ASSERT_EQUAL_STRING("0.005", buf);
+    TEST_ASSERT_EQUAL_INT(3, fixed_fmt(buf, sizeof(buf), 7, 2));
+    TEST_ASSERT_EQUAL_STRING("700", buf);
+}
+
+static void test_fixed_fmt_negative(void)
+{
+    TEST_ASSERT_EQUAL_INT(4, fixed_fmt(buf, sizeof(buf), -5, -1));
+    TEST_ASSERT_EQUAL_STRING("-0.5", buf);
+    TEST_ASSERT_EQUAL_INT(6, fixed_fmt(buf, sizeof(buf), -2153, -2));
+    TEST_ASSERT_EQUAL_STRING("-21.53", buf);
+    TEST_ASSERT_EQUAL_INT(4, fixed_fmt(buf, sizeof(buf), -7, 2));
+    TEST_ASSERT_EQUAL_STRING("-700", buf);
+    TEST_ASSERT_EQUAL_INT(11, fixed_fmt(buf, sizeof(buf), INT32_MIN, 0));
+    TEST_ASSERT_EQUAL_STRING("-2147483648", buf);
+    TEST_ASSERT_EQUAL_INT(12, fixed_fmt(buf, sizeof(buf), INT32_MIN, -9));
+    TEST_ASSERT_EQUAL_STRING("-2.147483648", buf);
+}
+
+static void test_fixed_fmt_too_small(void)
+{
+    /* the terminating NUL must fit too */
+    TEST_ASSERT_EQUAL_INT(-1, fixed_fmt(buf, 6, -2153, -2));
+    TEST_ASSERT_EQUAL_INT(6, fixed_fmt(buf, 7, -2153, -2));
+    /* scales beyond the table, values overflowing once scaled */
+    TEST_ASSERT_EQUAL_INT(-1, fixed_fmt(buf, sizeof(buf), 1, 10));
+    TEST_ASSERT_EQUAL_INT(-1, fixed_fmt(buf, sizeof(buf), 1, -10));
+    TEST_ASSERT_EQUAL_INT(-1, fixed_fmt(buf, sizeof(buf), 100, 8));
+}
+
+Test *tests_fixed_tests(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_fixed_convert),
+        new_TestFixture(test_fixed_convert_negative),
+        new_TestFixture(test_fixed_fmt),
+        new_TestFixture(test_fixed_fmt_negative),
+        new_TestFixture(test_fixed_fmt_too_small),
+    };
+
+    EMB_UNIT_TESTCALLER(fixed_tests, set_up, NULL, fixtures);
+
+    return (Test *)&fixed_tests;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "embUnit.h"
+#include "xtimer.h"
+
+#include "telemetry.h"
+#include "telemetry_encode.h"
+#include "tests.h"
+
+static uint8_t buf[64];
+
+static const telemetry_reading_t temperature = {
+    "temperature", "°C", 2153, -2, 0
+};
+static const telemetry_reading_t pressure = {
+    "pressure", "hPa", 101325, -2, 0
+};
+static const telemetry_reading_t cold = {
+    "temperature", "°C", -5, -1, 0
+};
+
+static void set_up(void)
+{
+    memset(buf, 0, sizeof(buf));
+}
+
+static void test_telemetry_encode_text(void)
+{
+    const telemetry_reading_t readings[] = { temperature, pressure, cold };
+    static const char expected[] =
+        "temperature:21.53°C\npressure:1013.25hPa\ntemperature:-0.5°C";
+
+    int res = telemetry_encode(TELEMETRY_FORMAT_TEXT, readings, 3, buf,
+                               sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(sizeof(expected) - 1, res);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(expected, buf, res));
+}
+
+static void test_telemetry_encode_response_text(void)
+{
+    int res = telemetry_encode_response(TELEMETRY_FORMAT_TEXT, &cold, 1,
+                                        buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(strlen("-0.5°C"), res);
+    TEST_ASSERT_EQUAL_STRING("-0.5°C", (char *)buf);
+}
+
+static void test_telemetry_encode_cbor(void)
+{
+    const telemetry_reading_t readings[] = { temperature, cold };
+    /* [["temperature", 4([-2, 2153]), 0], ["temperature", 4([-1, -5]), 0]] */
+    static const uint8_t expected[] = {
+        0x82,
+        0x83, 0x6b, 't', 'e', 'm', 'p', 'e', 'r', 'a', 't', 'u', 'r', 'e',
+        0xc4, 0x82, 0x21, 0x19, 0x08, 0x69, 0x00,
+        0x83, 0x6b, 't', 'e', 'm', 'p', 'e', 'r', 'a', 't', 'u', 'r', 'e',
+        0xc4, 0x82, 0x20, 0x24, 0x00
+    };
+
+    int res = telemetry_encode(TELEMETRY_FORMAT_CBOR, readings, 2, buf,
+                               sizeof(buf));
+    TEST_ASSERT_BYTES(expected, buf, res);
+}
+
+static void test_telemetry_encode_senml_units(void)
+{
+    const telemetry_reading_t readings[] = { temperature, pressure };
+    /* [{0: "temperature", 1: "Cel", 2: 4([-2, 2153])},
+     *  {0: "pressure", 1: "Pa", 2: 101325}], hPa becoming Pa shifts the
+     * scale to 0 and drops the decimal fraction */
+    static const uint8_t expected[] = {
+        0x82,
+        0xa3, 0x00, 0x6b, 't', 'e', 'm', 'p', 'e', 'r', 'a', 't', 'u', 'r',
+        'e', 0x01, 0x63, 'C', 'e', 'l', 0x02, 0xc4, 0x82, 0x21, 0x19, 0x08,
+        0x69,
+        0xa3, 0x00, 0x68, 'p', 'r', 'e', 's', 's', 'u', 'r', 'e', 0x01, 0x62,
+        'P', 'a', 0x02, 0x1a, 0x00, 0x01, 0x8b, 0xcd
+    };
+
+    int res = telemetry_encode(TELEMETRY_FORMAT_SENML_CBOR, readings, 2, buf,
+                               sizeof(buf));
+    TEST_ASSERT_BYTES(expected, buf, res);
+}
+
+static void test_telemetry_encode_senml_no_unit(void)
+{
+    const telemetry_reading_t reading = { "count", "", 7, 0, 0 };
+    /* [{0: "count", 2: 7}] */
+    static const uint8_t expected[] = {
+        0x81, 0xa2, 0x00, 0x65, 'c', 'o', 'u', 'n', 't', 0x02, 0x07
+    };
+
+    int res = telemetry_encode(TELEMETRY_FORMAT_SENML_CBOR, &reading, 1, buf,
+                               sizeof(buf));
+    TEST_ASSERT_BYTES(expected, buf, res);
+}
+
+static void test_telemetry_encode_senml_time(void)
+{
+    /* sampled two seconds before the encoding */
+    telemetry_reading_t reading = { "count", "", 7, 0, 0 };
+    reading.time = xtimer_now_usec() - 2000000;
+    /* [{0: "count", 2: 7, 6: 4([-6, t])}], t a negative 32-bit integer */
+    static const uint8_t expected[] = {
+        0x81, 0xa3, 0x00, 0x65, 'c', 'o', 'u', 'n', 't', 0x02, 0x07,
+        0x06, 0xc4, 0x82, 0x25, 0x3a
+    };
+
+    int res = telemetry_encode(TELEMETRY_FORMAT_SENML_CBOR, &reading, 1, buf,
+                               sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(sizeof(expected) + 4, res);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(expected, buf, sizeof(expected)));
+
+    const uint8_t *arg = &buf[sizeof(expected)];
+    int32_t time = -1 - (int32_t)(((uint32_t)arg[0] << 24) |
+                                  ((uint32_t)arg[1] << 16) |
+                                  ((uint32_t)arg[2] << 8) | arg[3]);
+    TEST_ASSERT(time <= -2000000);
+    TEST_ASSERT(time > -3000000);
+}
+
+static void test_telemetry_encode_too_small(void)
+{
+    TEST_ASSERT_EQUAL_INT(-1, telemetry_encode(TELEMETRY_FORMAT_TEXT,
+                                               &temperature, 1, buf, 8));
+    TEST_ASSERT_EQUAL_INT(-1, telemetry_encode(TELEMETRY_FORMAT_CBOR,
+                                               &temperature, 1, buf, 8));
+    TEST_ASSERT_EQUAL_INT(-1, telemetry_encode(TELEMETRY_FORMAT_SENML_CBOR,
+                                               &temperature, 1, buf, 8));
+    TEST_ASSERT_EQUAL_INT(-1, telemetry_encode(42, &temperature, 1, buf,
+                                               sizeof(buf)));
+}
+
+Test *tests_telemetry_encode_tests(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_telemetry_encode_text),
+        new_TestFixture(test_telemetry_encode_response_text),
+        new_TestFixture(test_telemetry_encode_cbor),
+        new_TestFixture(test_telemetry_encode_senml_units),
+        new_TestFixture(test_telemetry_encode_senml_no_unit),
+        new_TestFixture(test_telemetry_encode_senml_time),
+        new_TestFixture(test_telemetry_encode_too_small),
+    };
+
+    EMB_UNIT_TESTCALLER(telemetry_encode_tests, set_up, NULL, fixtures);
+
+    return (Test *)&telemetry_encode_tests;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2017 Inria
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v3. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Unit tests of the common code, one embUnit test caller per module.
+ */
+
+#ifndef TESTS_H
+#define TESTS_H
+
+#include "embUnit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Check the @p len bytes at @p buf against the array @p expected. */
+#define TEST_ASSERT_BYTES(expected, buf, len) \
+    do { \
+        TEST_ASSERT_EQUAL_INT(sizeof(expected), (len)); \
+        TEST_ASSERT_EQUAL_INT(0, memcmp((expected), (buf), (len))); \
+    } while (0)
+
+Test *tests_cbor_tests(void);
+Test *tests_fixed_tests(void);
+Test *tests_telemetry_encode_tests(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TESTS_H */
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+# Copyright (C) 2017 Inria
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v3. See the file LICENSE in the top level
+# directory for more details.
+
+"""End-to-end benchmark of a firmware built for the native board.
+
+Starts the broker stand-in, boots the firmware on a tap interface, waits for
+the link-local address it prints and for its CoAP server, then runs the load
+generator against it. The node must have been built with BROKER_ADDR set to
+an address of the host on the tap bridge, see "make bench" at the top of the
+repository.
+
+    tools/bench/bench.py --tap tap0 --iface tapbr0 \\
+        firmwares/node_bmp180/bin/native/node_bmp180.elf
+"""
+
+import argparse
+import json
+import re
+import subprocess
+import sys
+import threading
+import time
+
+import broker
+import coap
+import loadgen
+
+ADDR_RE = re.compile(r'inet6 addr: (fe80:[0-9a-fA-F:]+)(/\d+)?\s+scope: local')
+
+
+class Node(object):
+    """The firmware running on the host, its output copied to @p log."""
+
+    def __init__(self, elf, tap, log=None):
+        self.address = None
+        self.ready = threading.Event()
+        self.log = log
+        self.proc = subprocess.Popen([elf, tap], stdin=subprocess.PIPE,
+                                     stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT)
+        self.reader = threading.Thread(target=self._read, daemon=True)
+        self.reader.start()
+
+    def _read(self):
+        for line in iter(self.proc.stdout.readline, b''):
+            line = line.decode(errors='replace')
+            if self.log:
+                self.log.write(line)
+            match = ADDR_RE.search(line)
+            if match and self.address is None:
+                self.address = match.group(1)
+                self.ready.set()
+        self.ready.set()
+
+    def stop(self):
+        self.proc.terminate()
+        try:
+            self.proc.wait(5)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            self.proc.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('elf', help='firmware built with BOARD=native')
+    parser.add_argument('--tap', default='tap0', help='tap of the node')
+    parser.add_argument('--iface', default=None,
+                        help='host interface of the tap, or its bridge')
+    parser.add_argument('-r', '--request', action='append', default=[],
+                        help='"<METHOD> <uri> [<payload>]", repeatable, '
+                        'every resource by default')
+    parser.add_argument('-n', '--count', type=int, default=2000)
+    parser.add_argument('--warmup', type=int, default=100)
+    parser.add_argument('-c', '--concurrency', type=int, default=1)
+    parser.add_argument('--rate', type=float, default=0.0)
+    parser.add_argument('--timeout', type=float, default=2.0)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--boot-timeout', type=float, default=30.0)
+    parser.add_argument('--log', help='write the node output to this file')
+    parser.add_argument('--json', help='write the results to this file')
+    args = parser.parse_args()
+
+    log = open(args.log, 'w') if args.log else None
+    pushes = broker.Broker(coap.PORT, seed=args.seed)
+    pushes.start()
+    node = Node(args.elf, args.tap, log)
+    try:
+        if not node.ready.wait(args.boot_timeout) or node.address is None:
+            sys.exit('Error: the node printed no link-local address')
+        host = '%s%%%s' % (node.address, args.iface or args.tap)
+        gen = loadgen.LoadGenerator(loadgen.resolve(host), [],
+                                    args.concurrency, args.rate,
+                                    args.timeout, args.seed)
+        # the server loop starts once the addresses are printed
+        deadline = time.monotonic() + args.boot_timeout
+        while True:
+            try:
+                gen.fetch('/name')
+                break
+            except IOError:
+                if time.monotonic() > deadline:
+                    sys.exit('Error: no CoAP reply from %s' % host)
+        gen.requests = ([loadgen.parse_request(r) for r in args.request] or
+                        gen.discover())
+        result = gen.run(args.count, args.warmup)
+        gen.close()
+    finally:
+        node.stop()
+        pushes.stop()
+        if log:
+            log.close()
+
+    print('node %s, %s' % (host, args.elf))
+    loadgen.print_result(result)
+    broker.print_summary(pushes.summary())
+    if args.json:
+        result['pushed'] = pushes.summary()
+        result['firmware'] = args.elf
+        with open(args.json, 'w') as f:
+            json.dump(result, f, indent=2, sort_keys=True)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+# Copyright (C) 2017 Inria
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v3. See the file LICENSE in the top level
+# directory for more details.
+
+"""Broker stand-in: receives the messages pushed by the nodes.
+
+Every request is counted by path with its size, Block1 requests once per
+block. CON requests are acknowledged with a piggybacked 2.04, or 2.31 for
+the blocks before the last one, unless dropped to simulate a lossy link
+with --loss.
+
+    tools/bench/broker.py [--port 5683] [--loss 0.1] [-v]
+"""
+
+import argparse
+import collections
+import random
+import select
+import socket
+import sys
+import threading
+import time
+
+import coap
+
+
+class Path(object):
+    """Messages received on a path."""
+
+    def __init__(self):
+        self.count = 0
+        self.duplicates = 0
+        self.sizes = []
+        self.payload_sizes = []
+        self.first = None
+        self.last = None
+
+
+class Broker(threading.Thread):
+    """Receive pushed messages on @p port until stop() is called."""
+
+    def __init__(self, port=coap.PORT, loss=0.0, seed=1, verbose=False):
+        super(Broker, self).__init__(daemon=True)
+        self.sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(('::', port))
+        self.loss = loss
+        self.random = random.Random(seed)
+        self.verbose = verbose
+        self.paths = collections.OrderedDict()
+        self.malformed = 0
+        self.dropped = 0
+        self.seen = collections.deque(maxlen=256)  # (address, mid) of CONs
+        self.lock = threading.Lock()
+        self.running = True
+
+    def stop(self):
+        self.running = False
+        self.join()
+        self.sock.close()
+
+    def run(self):
+        while self.running:
+            ready, _, _ = select.select([self.sock], [], [], 0.1)
+            if ready:
+                data, addr = self.sock.recvfrom(2048)
+                self._handle(data, addr)
+
+    def _handle(self, data, addr):
+        now = time.monotonic()
+        try:
+            msg = coap.decode(data)
+        except ValueError:
+            self.malformed += 1
+            return
+        if msg.code not in (coap.POST, coap.PUT):
+            return  # ACK, RST, response or GET, nothing pushed
+        if self.loss and self.random.random() < self.loss:
+            self.dropped += 1
+            return
+
+        path = coap.uri_path(msg)
+        with self.lock:
+            stats = self.paths.setdefault(path, Path())
+            key = (addr[0], msg.mid)
+            if msg.type == coap.CON and key in self.seen:
+                stats.duplicates += 1
+            else:
+                if msg.type == coap.CON:
+                    self.seen.append(key)
+                stats.count += 1
+                stats.sizes.append(len(data))
+                stats.payload_sizes.append(len(msg.payload))
+                stats.first = stats.first if stats.first is not None else now
+                stats.last = now
+        if self.verbose:
+            print('%s %s %s %r' % (addr[0], 'CON' if msg.type == coap.CON
+                                   else 'NON', path, msg.payload))
+        if msg.type == coap.CON:
+            block1 = coap.option(msg, coap.BLOCK1)
+            if block1 and block1[-1] & 0x08:
+                # more blocks to come, acknowledged block by block
+                rsp = coap.ack(msg, coap.CONTINUE)
+                rsp.options.append((coap.BLOCK1, block1))
+            else:
+                rsp = coap.ack(msg, coap.CHANGED)
+            self.sock.sendto(coap.encode(rsp), addr)
+
+    def summary(self):
+        """Statistics of the received messages, by path."""
+        with self.lock:
+            paths = {}
+            for path, stats in self.paths.items():
+                span = (stats.last - stats.first) if stats.count > 1 else 0
+                paths[path] = {
+                    'messages': stats.count,
+                    'duplicates': stats.duplicates,
+                    'rate': (stats.count - 1) / span if span else 0.0,
+                    'size_mean': sum(stats.sizes) / len(stats.sizes),
+                    'size_max': max(stats.sizes),
+                    'payload_mean': (sum(stats.payload_sizes) /
+                                     len(stats.payload_sizes)),
+                }
+            return {'paths': paths, 'malformed': self.malformed,
+                    'dropped': self.dropped}
+
+
+def print_summary(summary, out=sys.stdout):
+    out.write('%-20s %8s %6s %8s %10s %8s\n' % (
+        'pushed', 'messages', 'dups', 'msg/s', 'size mean', 'size max'))
+    for path, stats in sorted(summary['paths'].items()):
+        out.write('%-20s %8d %6d %8.2f %10.1f %8d\n' % (
+            path, stats['messages'], stats['duplicates'], stats['rate'],
+            stats['size_mean'], stats['size_max']))
+    if summary['malformed'] or summary['dropped']:
+        out.write('malformed: %d, dropped: %d\n' % (summary['malformed'],
+                                                   summary['dropped']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--port', type=int, default=coap.PORT)
+    parser.add_argument('--loss', type=float, default=0.0,
+                        help='fraction of requests dropped')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='print every request')
+    args = parser.parse_args()
+
+    broker = Broker(args.port, args.loss, args.seed, args.verbose)
+    broker.start()
+    try:
+        while True:
+            time.sleep(1)
+    except KeyboardInterrupt:
+        pass
+    broker.stop()
+    print_summary(broker.summary())
+
+
+if __name__ == '__main__':
+    main()
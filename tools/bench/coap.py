@@ -0,0 +1,135 @@
+# Copyright (C) 2017 Inria
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v3. See the file LICENSE in the top level
+# directory for more details.
+
+"""Minimal CoAP (RFC 7252) message codec, enough to drive the firmwares."""
+
+import collections
+
+VERSION = 1
+PORT = 5683
+
+CON, NON, ACK, RST = range(4)
+
+EMPTY = 0x00
+GET, POST, PUT, DELETE = 0x01, 0x02, 0x03, 0x04
+CHANGED = 0x44
+CONTINUE = 0x5f
+
+OBSERVE = 6
+URI_PATH = 11
+CONTENT_FORMAT = 12
+URI_QUERY = 15
+ACCEPT = 17
+BLOCK2 = 23
+BLOCK1 = 27
+
+METHODS = {'GET': GET, 'POST': POST, 'PUT': PUT, 'DELETE': DELETE}
+
+Message = collections.namedtuple(
+    'Message', 'type code mid token options payload')
+
+
+def code_str(code):
+    """Return @p code as "c.dd"."""
+    return '%d.%02d' % (code >> 5, code & 0x1f)
+
+
+def _option_nibble(value):
+    if value < 13:
+        return value, b''
+    if value < 269:
+        return 13, bytes([value - 13])
+    return 14, (value - 269).to_bytes(2, 'big')
+
+
+def uint_option(value):
+    """Encode @p value as the shortest unsigned integer option value."""
+    return value.to_bytes((value.bit_length() + 7) // 8, 'big')
+
+
+def encode(msg):
+    """Serialize the Message @p msg."""
+    out = bytearray([(VERSION << 6) | (msg.type << 4) | len(msg.token),
+                     msg.code, msg.mid >> 8, msg.mid & 0xff])
+    out += msg.token
+    last = 0
+    for number, value in sorted(msg.options, key=lambda o: o[0]):
+        delta, delta_ext = _option_nibble(number - last)
+        length, length_ext = _option_nibble(len(value))
+        out.append((delta << 4) | length)
+        out += delta_ext + length_ext + value
+        last = number
+    if msg.payload:
+        out.append(0xff)
+        out += msg.payload
+    return bytes(out)
+
+
+def _read_nibble(nibble, data, pos):
+    if nibble == 13:
+        return data[pos] + 13, pos + 1
+    if nibble == 14:
+        return int.from_bytes(data[pos:pos + 2], 'big') + 269, pos + 2
+    if nibble == 15:
+        raise ValueError('reserved option nibble')
+    return nibble, pos
+
+
+def decode(data):
+    """Parse the datagram @p data, raise ValueError if it is malformed."""
+    if len(data) < 4 or data[0] >> 6 != VERSION:
+        raise ValueError('not a CoAP message')
+    tkl = data[0] & 0x0f
+    if tkl > 8 or len(data) < 4 + tkl:
+        raise ValueError('bad token length')
+    pos = 4 + tkl
+    options = []
+    number = 0
+    payload = b''
+    while pos < len(data):
+        if data[pos] == 0xff:
+            payload = bytes(data[pos + 1:])
+            break
+        delta, length = data[pos] >> 4, data[pos] & 0x0f
+        delta, pos = _read_nibble(delta, data, pos + 1)
+        length, pos = _read_nibble(length, data, pos)
+        number += delta
+        if pos + length > len(data):
+            raise ValueError('truncated option')
+        options.append((number, bytes(data[pos:pos + length])))
+        pos += length
+    return Message((data[0] >> 4) & 0x03, data[1],
+                   (data[2] << 8) | data[3], bytes(data[4:4 + tkl]),
+                   options, payload)
+
+
+def option(msg, number, default=None):
+    """Return the first value of option @p number in @p msg."""
+    for num, value in msg.options:
+        if num == number:
+            return value
+    return default
+
+
+def uri_options(uri):
+    """Uri-Path and Uri-Query options of "/a/b?x=1&y"."""
+    path, _, query = uri.partition('?')
+    options = [(URI_PATH, seg.encode()) for seg in path.split('/') if seg]
+    if query:
+        options += [(URI_QUERY, q.encode()) for q in query.split('&')]
+    return options
+
+
+def uri_path(msg):
+    """The path of request @p msg, as "/a/b"."""
+    return '/' + '/'.join(v.decode(errors='replace')
+                          for n, v in msg.options if n == URI_PATH)
+
+
+def ack(request, code=EMPTY, payload=b''):
+    """ACK of the CON @p request, piggybacking a response unless EMPTY."""
+    token = request.token if code != EMPTY else b''
+    return Message(ACK, code, request.mid, token, [], payload)
@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+# Copyright (C) 2017 Inria
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v3. See the file LICENSE in the top level
+# directory for more details.
+
+"""CoAP load generator: fires requests at a node and measures its replies.
+
+Requests are confirmable and drawn from the given list with a seeded
+generator, with up to --concurrency of them outstanding (closed loop), or
+started every 1/--rate seconds (open loop). Without -r, every resource listed
+in /.well-known/core is fetched, and /led is toggled too.
+
+    tools/bench/loadgen.py fe80::2%tapbr0 -r "GET /temperature" \\
+        -r "PUT /led 1" --count 1000 --concurrency 4
+"""
+
+import argparse
+import collections
+import json
+import math
+import random
+import select
+import socket
+import sys
+import time
+
+import coap
+
+Request = collections.namedtuple('Request', 'method uri payload')
+
+TOKEN_LEN = 4
+BLOCK_SZX = 1           # 32-byte blocks, as the firmwares use
+
+
+def parse_request(text):
+    """Parse "<METHOD> <uri> [<payload>]"."""
+    parts = text.split(None, 2)
+    if len(parts) < 2 or parts[0].upper() not in coap.METHODS:
+        raise ValueError('expected "<METHOD> <uri> [<payload>]": %r' % text)
+    payload = parts[2].encode() if len(parts) == 3 else b''
+    return Request(parts[0].upper(), parts[1], payload)
+
+
+def resolve(host, port=coap.PORT):
+    """Socket address of @p host, a link-local one with its %<iface>."""
+    return socket.getaddrinfo(host, port, socket.AF_INET6,
+                              socket.SOCK_DGRAM)[0][4]
+
+
+def percentile(values, pct):
+    """Nearest-rank percentile of the sorted @p values."""
+    if not values:
+        return 0.0
+    rank = int(math.ceil(pct / 100.0 * len(values)))
+    return values[max(0, min(len(values), rank) - 1)]
+
+
+def summarize(latencies):
+    latencies = sorted(latencies)
+    return {
+        'p50': percentile(latencies, 50),
+        'p90': percentile(latencies, 90),
+        'p99': percentile(latencies, 99),
+        'max': latencies[-1] if latencies else 0.0,
+        'mean': sum(latencies) / len(latencies) if latencies else 0.0,
+    }
+
+
+class Kind(object):
+    """Results of one of the requests of the load."""
+
+    def __init__(self, request):
+        self.request = request
+        self.sent = 0
+        self.latencies = []     # ms, of the 2.xx replies
+        self.errors = collections.Counter()     # other codes
+        self.timeouts = 0
+        self.request_sizes = []
+        self.response_sizes = []
+
+    def result(self):
+        return {
+            'request': ' '.join([self.request.method, self.request.uri] +
+                                ([self.request.payload.decode()]
+                                 if self.request.payload else [])),
+            'sent': self.sent,
+            'ok': len(self.latencies),
+            'errors': dict(self.errors),
+            'timeouts': self.timeouts,
+            'latency_ms': summarize(self.latencies),
+            'request_size': max(self.request_sizes or [0]),
+            'response_size_mean': (sum(self.response_sizes) /
+                                   len(self.response_sizes)
+                                   if self.response_sizes else 0.0),
+            'response_size_max': max(self.response_sizes or [0]),
+        }
+
+
+class LoadGenerator(object):
+
+    def __init__(self, addr, requests, concurrency=1, rate=0.0, timeout=2.0,
+                 seed=1):
+        self.addr = addr
+        self.requests = requests
+        self.concurrency = max(1, concurrency)
+        self.rate = rate
+        self.timeout = timeout
+        self.random = random.Random(seed)
+        self.mid = self.random.randrange(0x10000)
+        self.sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+
+    def close(self):
+        self.sock.close()
+
+    def _next_mid(self):
+        self.mid = (self.mid + 1) & 0xffff
+        return self.mid
+
+    def _token(self):
+        return bytes(self.random.randrange(256) for _ in range(TOKEN_LEN))
+
+    def _encode(self, request, options=()):
+        options = coap.uri_options(request.uri) + list(options)
+        if request.payload:
+            options.append((coap.CONTENT_FORMAT, b''))  # text/plain
+        token = self._token()
+        return token, coap.encode(coap.Message(
+            coap.CON, coap.METHODS[request.method], self._next_mid(), token,
+            options, request.payload))
+
+    def _receive(self, wait):
+        """Next datagram from the node as (Message, size), or None."""
+        ready, _, _ = select.select([self.sock], [], [], max(0.0, wait))
+        if not ready:
+            return None
+        data, _ = self.sock.recvfrom(2048)
+        try:
+            msg = coap.decode(data)
+        except ValueError:
+            return None
+        if msg.type == coap.CON:
+            # separate response, acknowledge it
+            self.sock.sendto(coap.encode(coap.ack(msg)), self.addr)
+        if msg.code == coap.EMPTY:
+            return None
+        return msg, len(data)
+
+    def fetch(self, uri):
+        """GET @p uri block by block, returns the whole payload."""
+        payload = b''
+        num = 0
+        while True:
+            block2 = coap.uint_option((num << 4) | BLOCK_SZX)
+            token, data = self._encode(Request('GET', uri, b''),
+                                       [(coap.BLOCK2, block2)])
+            for _ in range(4):
+                self.sock.sendto(data, self.addr)
+                deadline = time.monotonic() + self.timeout
+                reply = None
+                while reply is None and time.monotonic() < deadline:
+                    reply = self._receive(deadline - time.monotonic())
+                    if reply and reply[0].token != token:
+                        reply = None
+                if reply:
+                    break
+            else:
+                raise IOError('no reply to GET %s' % uri)
+            msg = reply[0]
+            if msg.code >> 5 != 2:
+                raise IOError('GET %s: %s' % (uri, coap.code_str(msg.code)))
+            payload += msg.payload
+            block = coap.option(msg, coap.BLOCK2)
+            if not block or not (block[-1] & 0x08):
+                return payload
+            num = (int.from_bytes(block, 'big') >> 4) + 1
+
+    def discover(self):
+        """Requests of every resource of /.well-known/core."""
+        links = self.fetch('/.well-known/core').decode()
+        requests = []
+        for link in links.split(','):
+            uri = link.split(';')[0].strip().strip('<>')
+            if not uri or uri == '/.well-known/core':
+                continue
+            requests.append(Request('GET', uri, b''))
+            if uri == '/led':
+                requests.append(Request('PUT', uri, b'1'))
+        return requests
+
+    def run(self, count, warmup=0):
+        """Send @p warmup requests then @p count measured ones."""
+        kinds = [Kind(r) for r in self.requests]
+        pending = {}            # token: (kind, start, measured)
+        issued = 0
+        total = warmup + count
+        period = 1.0 / self.rate if self.rate > 0 else 0.0
+        next_start = time.monotonic()
+        start = None
+
+        while issued < total or pending:
+            now = time.monotonic()
+            while (issued < total and len(pending) < self.concurrency and
+                   now >= next_start):
+                index = self.random.randrange(len(kinds))
+                token, data = self._encode(kinds[index].request)
+                measured = issued >= warmup
+                if measured and start is None:
+                    start = now
+                self.sock.sendto(data, self.addr)
+                pending[token] = (index, now, measured)
+                if measured:
+                    kinds[index].sent += 1
+                    kinds[index].request_sizes.append(len(data))
+                issued += 1
+                next_start = (next_start + period) if period else now
+
+            wait = self.timeout
+            if pending:
+                wait = min(t for _, t, _ in pending.values()) + \
+                    self.timeout - now
+            if issued < total and len(pending) < self.concurrency:
+                wait = min(wait, next_start - now)
+            reply = self._receive(wait)
+            now = time.monotonic()
+
+            if reply and reply[0].token in pending:
+                msg, size = reply
+                index, sent, measured = pending.pop(msg.token)
+                if measured:
+                    kind = kinds[index]
+                    kind.response_sizes.append(size)
+                    if msg.code >> 5 == 2:
+                        kind.latencies.append((now - sent) * 1000.0)
+                    else:
+                        kind.errors[coap.code_str(msg.code)] += 1
+            for token, (index, sent, measured) in list(pending.items()):
+                if now - sent >= self.timeout:
+                    del pending[token]
+                    if measured:
+                        kinds[index].timeouts += 1
+
+        elapsed = (time.monotonic() - start) if start else 0.0
+        latencies = [l for k in kinds for l in k.latencies]
+        return {
+            'count': count,
+            'concurrency': self.concurrency,
+            'rate': self.rate,
+            'elapsed_s': elapsed,
+            'ok': len(latencies),
+            'errors': sum(sum(k.errors.values()) for k in kinds),
+            'timeouts': sum(k.timeouts for k in kinds),
+            'requests_per_s': len(latencies) / elapsed if elapsed else 0.0,
+            'latency_ms': summarize(latencies),
+            'requests': [k.result() for k in kinds],
+        }
+
+
+def print_result(result, out=sys.stdout):
+    out.write('%d requests in %.2f s, %d ok, %d errors, %d timeouts: '
+              '%.1f req/s\n' % (result['count'], result['elapsed_s'],
+                                result['ok'], result['errors'],
+                                result['timeouts'],
+                                result['requests_per_s']))
+    row = '%-24s %6s %6s %5s %8s %8s %8s %6s %6s\n'
+    out.write(row % ('request', 'sent', 'ok', 'fail', 'p50 ms', 'p99 ms',
+                     'max ms', 'req B', 'rsp B'))
+    for kind in result['requests']:
+        lat = kind['latency_ms']
+        out.write(row % (kind['request'][:24], kind['sent'], kind['ok'],
+                         sum(kind['errors'].values()) + kind['timeouts'],
+                         '%.2f' % lat['p50'], '%.2f' % lat['p99'],
+                         '%.2f' % lat['max'], kind['request_size'],
+                         kind['response_size_max']))
+    lat = result['latency_ms']
+    out.write(row % ('all', result['count'], result['ok'],
+                     result['errors'] + result['timeouts'],
+                     '%.2f' % lat['p50'], '%.2f' % lat['p99'],
+                     '%.2f' % lat['max'], '', ''))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', help='node address, fe80::...%%<iface>')
+    parser.add_argument('-p', '--port', type=int, default=coap.PORT)
+    parser.add_argument('-r', '--request', action='append', default=[],
+                        help='"<METHOD> <uri> [<payload>]", repeatable')
+    parser.add_argument('-n', '--count', type=int, default=1000)
+    parser.add_argument('--warmup', type=int, default=50)
+    parser.add_argument('-c', '--concurrency', type=int, default=1)
+    parser.add_argument('--rate', type=float, default=0.0,
+                        help='requests started per second, 0 closed loop')
+    parser.add_argument('--timeout', type=float, default=2.0)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--json', help='write the results to this file')
+    args = parser.parse_args()
+
+    gen = LoadGenerator(resolve(args.host, args.port), [], args.concurrency,
+                        args.rate, args.timeout, args.seed)
+    try:
+        gen.requests = ([parse_request(r) for r in args.request] or
+                        gen.discover())
+        result = gen.run(args.count, args.warmup)
+    finally:
+        gen.close()
+    print_result(result)
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(result, f, indent=2, sort_keys=True)
+
+
+if __name__ == '__main__':
+    main()